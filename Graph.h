@@ -0,0 +1,1345 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include <string>
+#include <iostream>
+#include <algorithm>
+#include <fstream>
+#include <memory>
+
+#include "Layout.h"
+#include "GraphTrace.h"
+#include "TextParse.h"
+#include "GraphSave.h"
+#include "MappedFile.h"
+#include "LiveTrace.h"
+#include "Multilevel.h"
+#include "NodeGrid.h"
+#include "Pool.h"
+#include "Simulation.h"
+
+// Glyphs of node labels. Every label is cut from the one glyph page the font keeps
+// for charSize, digits are rasterized there up front.
+class LabelAtlas {
+private:
+	const sf::Font* font = nullptr;
+
+	void addQuad(std::vector <sf::Vertex>& quads, const sf::Vector2f& pos, const sf::Color& col, const sf::Glyph& glyph, float thickness) const {
+		const float padding = 1;
+		float left = glyph.bounds.left - padding - thickness;
+		float top = glyph.bounds.top - padding - thickness;
+		float right = glyph.bounds.left + glyph.bounds.width + padding - thickness;
+		float bottom = glyph.bounds.top + glyph.bounds.height + padding - thickness;
+
+		float u1 = glyph.textureRect.left - padding;
+		float v1 = glyph.textureRect.top - padding;
+		float u2 = glyph.textureRect.left + glyph.textureRect.width + padding;
+		float v2 = glyph.textureRect.top + glyph.textureRect.height + padding;
+
+		quads.push_back(sf::Vertex(pos + sf::Vector2f(left, top), col, { u1, v1 }));
+		quads.push_back(sf::Vertex(pos + sf::Vector2f(right, top), col, { u2, v1 }));
+		quads.push_back(sf::Vertex(pos + sf::Vector2f(right, bottom), col, { u2, v2 }));
+		quads.push_back(sf::Vertex(pos + sf::Vector2f(left, bottom), col, { u1, v2 }));
+	}
+
+public:
+	static const int charSize = 20;
+	static constexpr float outline = 2;
+
+	void setFont(const sf::Font* _font) {
+		font = _font;
+		for (char c = '0'; c <= '9'; ++c) {
+			font->getGlyph(c, charSize, false);
+			font->getGlyph(c, charSize, false, outline);
+		}
+	}
+
+	const sf::Texture* getTexture() const {
+		if (font == nullptr) {
+			return nullptr;
+		}
+		return &font->getTexture(charSize);
+	}
+
+	// quads of str laid out as sf::Text does, outline glyphs first, then fill glyphs
+	void build(const std::string& str, std::vector <sf::Vertex>& quads, sf::FloatRect& bounds) const {
+		quads.clear();
+		bounds = sf::FloatRect();
+		if (font == nullptr) {
+			return;
+		}
+
+		float minX = 0, minY = 0, maxX = 0, maxY = 0;
+		bool first = true;
+		for (float thickness : { outline, 0.f }) {
+			sf::Color col = thickness > 0 ? sf::Color(20, 20, 20) : sf::Color(255, 255, 255);
+			float x = 0;
+			sf::Uint32 prev = 0;
+			for (unsigned char c : str) {
+				x += font->getKerning(prev, c, charSize);
+				prev = c;
+
+				const sf::Glyph& glyph = font->getGlyph(c, charSize, false, thickness);
+				addQuad(quads, { x, (float)charSize }, col, glyph, thickness);
+
+				if (thickness == 0) {
+					float left = x + glyph.bounds.left - outline;
+					float top = charSize + glyph.bounds.top - outline;
+					float right = x + glyph.bounds.left + glyph.bounds.width + outline;
+					float bottom = charSize + glyph.bounds.top + glyph.bounds.height + outline;
+					if (first) {
+						minX = left;
+						minY = top;
+						maxX = right;
+						maxY = bottom;
+						first = false;
+					}
+					minX = std::min(minX, left);
+					minY = std::min(minY, top);
+					maxX = std::max(maxX, right);
+					maxY = std::max(maxY, bottom);
+				}
+				x += font->getGlyph(c, charSize, false).advance;
+			}
+		}
+		bounds = sf::FloatRect(minX, minY, maxX - minX, maxY - minY);
+	}
+};
+
+class Node {
+private:
+	sf::Color fillCol;
+	sf::Color outlineCol;
+	float size = 0;
+	float outlineSize = 0;
+	std::string str;
+
+	// label quads in text coordinates, a cache rebuilt when drawn after the string changes
+	mutable std::vector <sf::Vertex> label;
+	mutable sf::FloatRect labelBounds;
+	mutable bool labelDirty = true;
+
+public:
+	void updateLabel(const LabelAtlas& atlas) const {
+		if (labelDirty) {
+			atlas.build(str, label, labelBounds);
+			labelDirty = false;
+		}
+	}
+	void resetLabel() {
+		labelDirty = true;
+	}
+	int getLabelVertexCount() const {
+		return label.size();
+	}
+	// label centered on pos and scaled to the node size
+	void setLabelQuads(sf::Vertex* quad, const sf::Vector2f& pos) const {
+		float sz = std::max(labelBounds.width, labelBounds.height);
+		float k = sz > 0 ? size * 1.3f / sz : 0.f;
+		sf::Vector2f center(labelBounds.left + labelBounds.width / 2, labelBounds.top + labelBounds.height / 2);
+		for (int i = 0; i < label.size(); ++i) {
+			quad[i] = label[i];
+			quad[i].position = pos + (label[i].position - center) * k;
+		}
+	}
+
+	// outline quad and fill quad over a disc texture
+	void setQuads(sf::Vertex* quad, const sf::Vector2f& pos) const {
+		setQuad(quad, pos, size + outlineSize, outlineCol);
+		setQuad(quad + 4, pos, size, fillCol);
+	}
+	// one quad in the outline color, for nodes too small on screen to show the fill
+	void setPointQuad(sf::Vertex* quad, const sf::Vector2f& pos, float minRadius) const {
+		setQuad(quad, pos, std::max(size + outlineSize, minRadius), outlineCol);
+	}
+	static void setQuad(sf::Vertex* quad, const sf::Vector2f& pos, float radius, const sf::Color& col) {
+		quad[0].position = pos + sf::Vector2f(-radius, -radius);
+		quad[1].position = pos + sf::Vector2f(radius, -radius);
+		quad[2].position = pos + sf::Vector2f(radius, radius);
+		quad[3].position = pos + sf::Vector2f(-radius, radius);
+		for (int i = 0; i < 4; ++i) {
+			quad[i].color = col;
+		}
+	}
+
+	void setFillColor(const sf::Color& col) {
+		fillCol = col;
+	}
+	void setOutlineColor(const sf::Color& col) {
+		outlineCol = col;
+	}
+	void setSize(float sz) {
+		size = sz;
+	}
+	void setOutlineSize(float sz) {
+		outlineSize = sz;
+	}
+	void setString(const std::string& text) {
+		if (str != text) {
+			str = text;
+			labelDirty = true;
+		}
+	}
+
+	bool isContains(const sf::Vector2f& pos, const sf::Vector2f& point) const {
+		return length(point - pos) <= size + outlineSize;
+	}
+	float getRadius() const {
+		return size + outlineSize;
+	}
+
+	sf::Color getColor() const {
+		return outlineCol;
+	}
+
+	int getNum() const {
+		return std::stoi(str);
+	}
+};
+
+class Edge {
+private:
+	sf::Color col;
+	float size = 3;
+
+public:
+	void draw(sf::RenderTarget& window, sf::RenderStates states, const sf::Vector2f& pos1, const sf::Vector2f& pos2) const {
+		sf::Vertex quad[4];
+		setQuad(quad, pos1, pos2);
+		window.draw(quad, 4, sf::Quads, states);
+	}
+
+	void setQuad(sf::Vertex* quad, const sf::Vector2f& pos1, const sf::Vector2f& pos2) const {
+		setQuad(quad, pos1, pos2, size, 1.f);
+	}
+	// width is half the width of the quad, alpha scales the alpha of the color
+	void setQuad(sf::Vertex* quad, const sf::Vector2f& pos1, const sf::Vector2f& pos2, float width, float alpha) const {
+		sf::Vector2f vec = pos1 - pos2;
+		vec /= length(vec);
+		vec = sf::Vector2f(-vec.y, vec.x);
+
+		quad[0].position = pos1 + vec * width;
+		quad[1].position = pos1 - vec * width;
+		quad[2].position = pos2 - vec * width;
+		quad[3].position = pos2 + vec * width;
+		sf::Color c = col;
+		c.a = (sf::Uint8)(c.a * alpha);
+		for (int i = 0; i < 4; ++i) {
+			quad[i].color = c;
+		}
+	}
+
+	void setColor(const sf::Color& color) {
+		col = color;
+	}
+	void setSize(float sz) {
+		size = sz;
+	}
+	float getSize() const {
+		return size;
+	}
+
+	sf::Color getColor() const {
+		return col;
+	}
+};
+
+sf::Color eBaseCol(100, 100, 100);
+
+typedef Pool <Node>::Handle NodeHandle;
+typedef Pool <Edge>::Handle EdgeHandle;
+
+// All edges go to one vertex array, all nodes to another and all labels to a third,
+// they are rewritten in place every frame, so a frame is three draw calls. Only what
+// is in the view is written, and how it is drawn depends on its size on the screen.
+class GraphRenderer {
+private:
+	static const int discSize = 128;
+	// node radius in pixels below which the node is one quad and below which it has no label
+	static constexpr float pointPixels = 3;
+	static constexpr float labelPixels = 7;
+	// edges never get narrower than that on the screen, they fade instead
+	static constexpr float minEdgePixels = 1;
+	static constexpr float minEdgeAlpha = 0.25f;
+
+	sf::VertexArray edgeQuads;
+	sf::VertexArray nodeQuads;
+	sf::VertexArray labelQuads;
+	LabelAtlas atlas;
+	sf::Texture disc;
+	bool discReady = false;
+	int drawCalls = 0;
+
+	std::vector <int> visibleNodes;
+	std::vector <int> visibleEdges;
+
+	void makeDisc() {
+		sf::Image image;
+		image.create(discSize, discSize, sf::Color(255, 255, 255, 0));
+		float r = discSize / 2.f;
+		for (int x = 0; x < discSize; ++x) {
+			for (int y = 0; y < discSize; ++y) {
+				float d = length(sf::Vector2f(x + 0.5f - r, y + 0.5f - r));
+				float alpha = std::min(std::max(r - d, 0.f), 1.f);
+				image.setPixel(x, y, sf::Color(255, 255, 255, (sf::Uint8)(alpha * 255)));
+			}
+		}
+		disc.loadFromImage(image);
+		disc.setSmooth(true);
+		discReady = true;
+	}
+
+	static void setDiscCoords(sf::Vertex* quad) {
+		quad[0].texCoords = { 0, 0 };
+		quad[1].texCoords = { (float)discSize, 0 };
+		quad[2].texCoords = { (float)discSize, (float)discSize };
+		quad[3].texCoords = { 0, (float)discSize };
+	}
+
+public:
+	GraphRenderer() : edgeQuads(sf::Quads), nodeQuads(sf::Quads), labelQuads(sf::Quads) {}
+
+	// labels of all nodes must be reset after that
+	void setFont(const sf::Font* font) {
+		atlas.setFont(font);
+	}
+
+	// node i of layout is nodes[node[i]] and edge i is edges[edge[i]],
+	// grid holds the nodes of layout, none of them is bigger than maxRadius
+	void draw(sf::RenderTarget& window, sf::RenderStates states, const Layout& layout,
+		const Pool <Node>& nodes, const std::vector <NodeHandle>& node,
+		const Pool <Edge>& edges, const std::vector <EdgeHandle>& edge, const NodeGrid& grid, float maxRadius) {
+		if (!discReady) {
+			makeDisc();
+		}
+		drawCalls = 0;
+
+		ProfileScope edgeScope("edges");
+		const sf::View& view = window.getView();
+		sf::FloatRect visible(view.getCenter() - view.getSize() / 2.f, view.getSize());
+		// screen pixels in a unit of the board
+		float pixel = window.getSize().x * view.getViewport().width / view.getSize().x;
+		float screenArea = visible.width * visible.height * pixel * pixel;
+
+		visibleEdges.clear();
+		float lengthSum = 0, coverage = 0;
+		for (int i = 0; i < edge.size(); ++i) {
+			const Layout::Spring& sp = layout.getSpring(i);
+			if (!sp.alive) {
+				continue;
+			}
+			sf::Vector2f a = layout.getPos(sp.u), b = layout.getPos(sp.v);
+			float w = edges[edge[i]].getSize();
+			sf::FloatRect box(std::min(a.x, b.x) - w, std::min(a.y, b.y) - w, std::abs(a.x - b.x) + w * 2, std::abs(a.y - b.y) + w * 2);
+			if (box.intersects(visible)) {
+				visibleEdges.push_back(i);
+				float len = length(a - b) * pixel;
+				lengthSum += len;
+				coverage += len * std::max(w * 2 * pixel, minEdgePixels);
+			}
+		}
+		// edges that would paint over more than the whole screen are drawn thin and fade
+		bool dense = coverage > screenArea;
+		float fade = dense ? std::min(std::max(screenArea / (lengthSum * minEdgePixels), minEdgeAlpha), 1.f) : 1.f;
+		edgeQuads.resize(visibleEdges.size() * 4);
+		for (int j = 0; j < visibleEdges.size(); ++j) {
+			int i = visibleEdges[j];
+			const Layout::Spring& sp = layout.getSpring(i);
+			float width = dense ? minEdgePixels : edges[edge[i]].getSize() * 2 * pixel;
+			float alpha = fade * std::min(width / minEdgePixels, 1.f);
+			width = std::max(width, minEdgePixels);
+			edges[edge[i]].setQuad(&edgeQuads[j * 4], layout.getPos(sp.u), layout.getPos(sp.v), width / 2 / pixel, alpha);
+		}
+		if (!visibleEdges.empty()) {
+			window.draw(edgeQuads, states);
+			++drawCalls;
+		}
+		edgeScope.end();
+
+		ProfileScope nodeScope("nodes");
+		visibleNodes.clear();
+		sf::FloatRect area(visible.left - maxRadius, visible.top - maxRadius, visible.width + maxRadius * 2, visible.height + maxRadius * 2);
+		grid.forEachInRect(area, [&](int i) {
+			sf::Vector2f p = layout.getPos(i);
+			float r = nodes[node[i]].getRadius();
+			if (p.x + r >= visible.left && p.x - r <= visible.left + visible.width &&
+				p.y + r >= visible.top && p.y - r <= visible.top + visible.height) {
+				visibleNodes.push_back(i);
+			}
+		});
+		// overlapping nodes are drawn in index order
+		std::sort(visibleNodes.begin(), visibleNodes.end());
+
+		int nodeVertices = 0;
+		for (int i : visibleNodes) {
+			nodeVertices += nodes[node[i]].getRadius() * pixel < pointPixels ? 4 : 8;
+		}
+		nodeQuads.resize(nodeVertices);
+		for (int k = 0, j = 0; k < visibleNodes.size(); ++k) {
+			int i = visibleNodes[k];
+			if (nodes[node[i]].getRadius() * pixel < pointPixels) {
+				// never smaller than a pixel, so zooming out does not make nodes vanish
+				nodes[node[i]].setPointQuad(&nodeQuads[j], layout.getPos(i), 1 / pixel);
+				setDiscCoords(&nodeQuads[j]);
+				j += 4;
+			}
+			else {
+				nodes[node[i]].setQuads(&nodeQuads[j], layout.getPos(i));
+				setDiscCoords(&nodeQuads[j]);
+				setDiscCoords(&nodeQuads[j + 4]);
+				j += 8;
+			}
+		}
+		if (!visibleNodes.empty()) {
+			sf::RenderStates discStates = states;
+			discStates.texture = &disc;
+			window.draw(nodeQuads, discStates);
+			++drawCalls;
+		}
+		nodeScope.end();
+
+		ProfileScope labelScope("labels");
+		int labelVertices = 0;
+		for (int i : visibleNodes) {
+			if (nodes[node[i]].getRadius() * pixel >= labelPixels) {
+				nodes[node[i]].updateLabel(atlas);
+				labelVertices += nodes[node[i]].getLabelVertexCount();
+			}
+		}
+		labelQuads.resize(labelVertices);
+		int j = 0;
+		for (int i : visibleNodes) {
+			if (nodes[node[i]].getRadius() * pixel >= labelPixels && nodes[node[i]].getLabelVertexCount() > 0) {
+				nodes[node[i]].setLabelQuads(&labelQuads[j], layout.getPos(i));
+				j += nodes[node[i]].getLabelVertexCount();
+			}
+		}
+		if (labelVertices > 0 && atlas.getTexture() != nullptr) {
+			sf::RenderStates labelStates = states;
+			labelStates.texture = atlas.getTexture();
+			window.draw(labelQuads, labelStates);
+			++drawCalls;
+		}
+	}
+
+	// draw calls of the last frame
+	int getDrawCalls() const {
+		return drawCalls;
+	}
+};
+
+// Node i and edge i are drawn at the positions of node i and spring i of layout.
+// Nodes and edges live in pools and are referred to by handles, node i is nodes[node[i]].
+class Graph : public sf::Drawable {
+private:
+	float scale = 1;
+	Layout layout;
+	Multilevel multilevel;
+	bool multilevelStart = true;
+
+	// physics on a thread of its own when set; layout then only keeps the nodes and springs,
+	// its edits go to the simulation through the journal and its positions come back
+	std::unique_ptr <Simulation> simulation;
+	int threads = 1;
+	float simulationRate = 0;
+	std::vector <Layout::Op> journal;
+	// made on the first draw with the font set last, so a graph that is never drawn
+	// has no textures and needs no GL context
+	mutable std::unique_ptr <GraphRenderer> renderer;
+	mutable bool fontChanged = false;
+
+	Pool <Node> nodes;
+	Pool <Edge> edges;
+	std::vector <NodeHandle> node;
+	std::vector <EdgeHandle> edge;
+	sf::Font font;
+
+	// node centers for picking, brought up to date before each query
+	mutable NodeGrid grid;
+	mutable bool gridDirty = true;
+	float maxRadius = 0;
+
+	// text actions are parsed once into records, group g is actions[groupStart[g]..groupStart[g + 1]),
+	// rActions[i] undoes actions[i] and is filled when its group is applied
+	std::vector <gtrace::Record> actions;
+	std::vector <gtrace::Record> rActions;
+	std::vector <int> groupStart = { 0 };
+	int curAction = 0;
+	int nodeCnt = 0;
+
+	// trace opened by openTrace; a binary one is read in place from the mapping,
+	// only the offsets of groups and their undo records are kept
+	MappedFile trace;
+	bool binaryTrace = false;
+	std::vector <size_t> traceGroup; // offsets of all groups and of the end of the last one
+	std::vector <char> undoKnown;
+
+	// trace opened by openLive, its groups are appended as they arrive
+	LiveTrace live;
+	bool liveStarted = false;
+
+	// colors and edges before group k * checkpointStep, seekAction starts from the nearest one
+	struct Checkpoint {
+		std::vector <sf::Uint32> nodeCol;
+		std::vector <sf::Uint32> edgeCol;
+		std::vector <char> alive;
+		std::vector <std::pair <int, int>> addedEdges; // edges after the first baseEdges
+	};
+	std::vector <Checkpoint> checkpoints;
+	int checkpointStep = 64;
+	int baseEdges = 0;
+
+	bool readActionGroup(std::istream& is) {
+		int n;
+		if (!(is >> n)) {
+			return false;
+		}
+		for (int i = 0; i < n; ++i) {
+			gtrace::Record rec;
+			if (gtrace::readText(is, rec)) {
+				actions.push_back(rec);
+			}
+		}
+		endGroup();
+		return true;
+	}
+	bool readActionGroup(const char*& p, const char* end) {
+		int n;
+		if (!tparse::getInt(p, end, n)) {
+			return false;
+		}
+		for (int i = 0; i < n; ++i) {
+			gtrace::Record rec;
+			if (tparse::getRecord(p, end, rec)) {
+				actions.push_back(rec);
+			}
+		}
+		endGroup();
+		return true;
+	}
+	// the actions after the last group start form a new group
+	void endGroup() {
+		groupStart.push_back(actions.size());
+		rActions.resize(actions.size());
+		undoKnown.push_back(false);
+	}
+
+	NodeHandle newNode(int num, float scale) {
+		NodeHandle h = nodes.create();
+		Node& nd = nodes[h];
+		nd.setSize(std::max(26 * scale, 9.f));
+		nd.setFillColor({ 50, 50, 50 });
+		nd.setOutlineSize(std::max(4 * scale, 1.f));
+		nd.setOutlineColor({ 255, 255, 255 });
+		nd.setString(std::to_string(num));
+		return h;
+	}
+	EdgeHandle newEdge(float scale) {
+		EdgeHandle h = edges.create();
+		edges[h].setSize(3 * scale);
+		edges[h].setColor(eBaseCol);
+		return h;
+	}
+
+	// the last edge takes index s
+	void removeEdge(int s) {
+		edges.release(edge[s]);
+		edge[s] = edge.back();
+		edge.pop_back();
+		layout.removeSpring(s);
+	}
+
+	void appendGroup(const std::vector <gtrace::Record>& group) {
+		actions.insert(actions.end(), group.begin(), group.end());
+		endGroup();
+	}
+
+	// a record of a broken trace may refer to nodes or edges that are not there, it is skipped
+	bool isValid(const gtrace::Record& rec) const {
+		switch (rec.op) {
+		case gtrace::NodeColor:
+			return rec.a < node.size();
+		case gtrace::EdgeAdd:
+			return rec.a < node.size() && rec.b < node.size();
+		case gtrace::EdgePop:
+			return !edge.empty();
+		default:
+			return rec.a < edge.size();
+		}
+	}
+
+	void apply(const gtrace::Record& rec) {
+		if (!isValid(rec)) {
+			return;
+		}
+		switch (rec.op) {
+		case gtrace::NodeColor:
+			nodes[node[rec.a]].setOutlineColor(sf::Color(rec.b));
+			break;
+		case gtrace::EdgeColor:
+			edges[edge[rec.a]].setColor(sf::Color(rec.b));
+			break;
+		case gtrace::EdgeAdd:
+			edge.push_back(newEdge(scale));
+			layout.addSpring(rec.a, rec.b, 200 * scale);
+			break;
+		case gtrace::EdgeDelete:
+			layout.setSpringAlive(rec.a, false);
+			break;
+		case gtrace::EdgePop:
+			edges.release(edge.back());
+			edge.pop_back();
+			layout.popSpring();
+			break;
+		case gtrace::EdgeRevive:
+			layout.setSpringAlive(rec.a, true);
+			break;
+		}
+	}
+
+	// a skipped record is undone by skipping it again
+	gtrace::Record inverse(const gtrace::Record& rec) const {
+		gtrace::Record res = rec;
+		if (!isValid(rec)) {
+			return res;
+		}
+		switch (rec.op) {
+		case gtrace::NodeColor:
+			res.b = nodes[node[rec.a]].getColor().toInteger();
+			break;
+		case gtrace::EdgeColor:
+			res.b = edges[edge[rec.a]].getColor().toInteger();
+			break;
+		case gtrace::EdgeAdd:
+			res.op = gtrace::EdgePop;
+			break;
+		case gtrace::EdgeDelete:
+		case gtrace::EdgeRevive:
+			// the edge gets back the state it had, deleting a deleted edge is undone by deleting it
+			res.op = layout.getSpring(rec.a).alive ? gtrace::EdgeRevive : gtrace::EdgeDelete;
+			break;
+		default:
+			break;
+		}
+		return res;
+	}
+
+	// offsets of all complete groups of the mapped trace, starting from traceGroup[0]
+	void indexRecordGroups() {
+		const char* p = trace.data() + traceGroup[0];
+		const char* end = trace.data() + trace.size();
+		while (p < end) {
+			uint32_t cnt;
+			if (!gtrace::getVarint(p, end, cnt)) {
+				break;
+			}
+			gtrace::Record rec;
+			uint32_t i = 0;
+			while (i < cnt && gtrace::getRecord(p, end, rec)) {
+				++i;
+			}
+			if (i < cnt) {
+				break;
+			}
+			traceGroup.push_back(p - trace.data());
+			groupStart.push_back(groupStart.back() + cnt);
+		}
+		rActions.resize(groupStart.back());
+		undoKnown.assign(traceGroup.size() - 1, false);
+	}
+
+	// applies group g and remembers how to undo it
+	void applyGroup(int g) {
+		if (g % checkpointStep == 0 && g / checkpointStep == checkpoints.size()) {
+			checkpoints.push_back(makeCheckpoint());
+		}
+		int first = groupStart[g];
+		int last = groupStart[g + 1];
+		if (binaryTrace) {
+			const char* p = trace.data() + traceGroup[g];
+			const char* end = trace.data() + traceGroup[g + 1];
+			uint32_t cnt;
+			gtrace::getVarint(p, end, cnt);
+			gtrace::Record rec;
+			for (int i = first; i < last && gtrace::getRecord(p, end, rec); ++i) {
+				rActions[i] = inverse(rec);
+				apply(rec);
+			}
+		}
+		else {
+			for (int i = first; i < last; ++i) {
+				rActions[i] = inverse(actions[i]);
+				apply(actions[i]);
+			}
+		}
+		undoKnown[g] = true;
+	}
+
+	void undoGroup(int g) {
+		for (int i = groupStart[g + 1] - 1; i >= groupStart[g]; --i) {
+			apply(rActions[i]);
+		}
+	}
+
+	Checkpoint makeCheckpoint() const {
+		Checkpoint cp;
+		for (auto h : node) {
+			cp.nodeCol.push_back(nodes[h].getColor().toInteger());
+		}
+		for (int i = 0; i < edge.size(); ++i) {
+			cp.edgeCol.push_back(edges[edge[i]].getColor().toInteger());
+			Layout::Spring sp = layout.getSpring(i);
+			cp.alive.push_back(sp.alive);
+			if (i >= baseEdges) {
+				cp.addedEdges.push_back({ sp.u, sp.v });
+			}
+		}
+		return cp;
+	}
+
+	// false if the graph does not have the nodes and the first edges the checkpoint was made with
+	bool restoreCheckpoint(int k) {
+		const Checkpoint& cp = checkpoints[k];
+		if (cp.nodeCol.size() != node.size() || edge.size() < baseEdges || cp.edgeCol.size() < baseEdges) {
+			return false;
+		}
+		while (edge.size() > cp.edgeCol.size()) {
+			apply({ gtrace::EdgePop });
+		}
+		while (edge.size() < cp.edgeCol.size()) {
+			auto [u, v] = cp.addedEdges[edge.size() - baseEdges];
+			gtrace::Record rec;
+			rec.op = gtrace::EdgeAdd;
+			rec.a = u;
+			rec.b = v;
+			apply(rec);
+		}
+		for (int i = 0; i < node.size(); ++i) {
+			nodes[node[i]].setOutlineColor(sf::Color(cp.nodeCol[i]));
+		}
+		for (int i = 0; i < edge.size(); ++i) {
+			edges[edge[i]].setColor(sf::Color(cp.edgeCol[i]));
+			layout.setSpringAlive(i, cp.alive[i]);
+		}
+		curAction = k * checkpointStep;
+		return true;
+	}
+
+	// groups, undo records and checkpoints refer to nodes and edges by index, so once the
+	// user has added or deleted some the trace is dropped and the graph stays as it is
+	void detachTrace() {
+		if (getActionCount() > 0 || live.isOpen()) {
+			resetTrace();
+			trace.close();
+		}
+		baseEdges = edge.size();
+	}
+
+	void resetTrace() {
+		actions.clear();
+		rActions.clear();
+		groupStart.assign(1, 0);
+		traceGroup.clear();
+		undoKnown.clear();
+		checkpoints.clear();
+		curAction = 0;
+		binaryTrace = false;
+		live.close();
+		liveStarted = false;
+	}
+
+	// n scattered nodes and edges with 0-based ends, as the header of a trace gives them
+	void startTrace(int n, const std::vector <std::pair <int, int>>& edges) {
+		layout.scatter(n);
+		layout.addSprings(edges, 200 * layoutScale(n));
+		if (multilevelStart) {
+			multilevel.place(layout);
+		}
+		makeElements();
+		baseEdges = edge.size();
+	}
+
+	// nodes and edges to draw for what is in layout
+	void makeElements() {
+		int n = layout.size();
+		int m = layout.springCount();
+		float scale = layoutScale(n);
+		//graph.scale = scale;
+		nodes.reserve(n);
+		node.reserve(n);
+		for (int i = 0; i < n; ++i) {
+			node.push_back(newNode(i + 1, scale));
+		}
+		edges.reserve(m);
+		edge.reserve(m);
+		for (int i = 0; i < m; ++i) {
+			edge.push_back(newEdge(scale));
+		}
+
+		nodeCnt = n;
+		maxRadius = n > 0 ? nodes[node[0]].getRadius() : 0.f;
+		grid.setCellSize(std::max(maxRadius * 2, 8.f));
+		gridDirty = true;
+	}
+
+	void refreshGrid() const {
+		if (!gridDirty) {
+			return;
+		}
+		for (int i = 0; i < node.size(); ++i) {
+			grid.update(i, layout.getPos(i));
+		}
+		gridDirty = false;
+	}
+
+public:
+	~Graph() {
+		clear();
+	}
+
+	void setFont(const sf::Font& _font) {
+		font = _font;
+		fontChanged = true;
+		for (auto h : node) {
+			nodes[h].resetLabel();
+		}
+	}
+
+	void setBoard(const sf::Vector2f& size, const sf::Vector2f& offset) {
+		layout.setBoard(size, offset);
+	}
+
+	void setRepulsion(Layout::Repulsion repulsion) {
+		layout.setRepulsion(repulsion);
+	}
+	Layout::Repulsion getRepulsion() const {
+		return layout.getRepulsion();
+	}
+	void setTheta(float theta) {
+		layout.setTheta(theta);
+	}
+	// with the simulation thread the physics runs there, the layout here only keeps the state
+	void setThreads(int _threads) {
+		threads = std::max(_threads, 1);
+		layout.setThreads(simulation ? 1 : threads);
+		if (simulation) {
+			simulation->setThreads(threads);
+		}
+	}
+	int getThreads() const {
+		return threads;
+	}
+	// physics on a thread of its own (Simulation), update then only takes the positions it
+	// has got to; the simulation starts from the current layout
+	void setSimulationThread(bool on) {
+		if (on == (simulation != nullptr)) {
+			return;
+		}
+		journal.clear();
+		if (on) {
+			simulation = std::make_unique <Simulation>();
+			simulation->setThreads(threads);
+			simulation->setStepRate(simulationRate);
+			layout.setThreads(1);
+			layout.describe(journal);
+			layout.setJournal(&journal);
+			simulation->submit(journal);
+		}
+		else {
+			simulation.reset();
+			layout.setThreads(threads);
+			layout.setJournal(nullptr);
+			layout.wake();
+		}
+	}
+	// steps a second of the simulation thread, 0 - as fast as the threads allow
+	void setSimulationRate(float rate) {
+		simulationRate = rate;
+		if (simulation) {
+			simulation->setStepRate(rate);
+		}
+	}
+	// big graphs are loaded with a multilevel placement, otherwise nodes start at random points
+	void setMultilevel(bool on) {
+		multilevelStart = on;
+	}
+
+	const Layout& getLayout() const {
+		return layout;
+	}
+
+	// frame of time seconds, physics runs in fixed steps and sleeps once the layout is still
+	void update(float time) {
+		if (simulation) {
+			simulation->submit(journal);
+			const Simulation::Frame* frame = simulation->takeFrame();
+			if (frame != nullptr && frame->x.size() == layout.size()) {
+				layout.setPositions(frame->x, frame->y, simulation->getPending());
+				gridDirty = true;
+			}
+			return;
+		}
+		if (!layout.isSleeping()) {
+			gridDirty = true;
+		}
+		layout.advance(time);
+	}
+	// exactly one step of time seconds, here and not on the simulation thread
+	void step(float time) {
+		layout.update(time);
+		gridDirty = true;
+	}
+	bool isSleeping() const {
+		if (simulation) {
+			return journal.empty() && simulation->isSleeping();
+		}
+		return layout.isSleeping();
+	}
+
+	// the current view of window decides what is drawn and at which detail
+	void draw(sf::RenderTarget& window, sf::RenderStates states) const {
+		refreshGrid();
+		if (!renderer) {
+			renderer = std::make_unique <GraphRenderer>();
+		}
+		if (fontChanged) {
+			renderer->setFont(&font);
+			fontChanged = false;
+		}
+		renderer->draw(window, states, layout, nodes, node, edges, edge, grid, maxRadius);
+	}
+
+	int getDrawCalls() const {
+		return renderer ? renderer->getDrawCalls() : 0;
+	}
+
+	friend std::istream& operator>>(std::istream& is, Graph& graph) {
+		graph.clear();
+
+		graph.resetTrace();
+		is >> graph.layout;
+		if (graph.multilevelStart) {
+			graph.multilevel.place(graph.layout);
+		}
+		graph.makeElements();
+		graph.baseEdges = graph.edge.size();
+
+		return is;
+	}
+
+	// text log or binary trace (told apart by the header), all groups are indexed here
+	bool openTrace(const std::string& path) {
+		clear();
+		resetTrace();
+
+		if (trace.open(path) && gtrace::isBinary(trace.data(), trace.size())) {
+			const char* p = trace.data() + 5;
+			const char* end = trace.data() + trace.size();
+			uint32_t n, m;
+			if (!gtrace::getVarint(p, end, n) || !gtrace::getVarint(p, end, m)) {
+				return false;
+			}
+			std::vector <std::pair <int, int>> edges(m);
+			for (auto& [u, v] : edges) {
+				uint32_t a, b;
+				if (!gtrace::getVarint(p, end, a) || !gtrace::getVarint(p, end, b)) {
+					return false;
+				}
+				u = a;
+				v = b;
+			}
+			startTrace(n, edges);
+			traceGroup.push_back(p - trace.data());
+			binaryTrace = true;
+			indexRecordGroups();
+		}
+		else if (!loadText(path)) {
+			return false;
+		}
+		checkpointStep = std::max(64, getActionCount() / 256);
+		return true;
+	}
+
+	// "n m", the edges and the action groups of a text log (a .txt save has no groups),
+	// parsed straight out of a mapping, the edges on all cores
+	bool loadText(const std::string& path) {
+		clear();
+		resetTrace();
+		trace.close();
+
+		MappedFile file;
+		if (!file.open(path)) {
+			return false;
+		}
+		const char* p = file.data();
+		const char* end = p + file.size();
+		int n, m;
+		std::vector <std::pair <int, int>> edges;
+		if (!tparse::getInt(p, end, n) || !tparse::getInt(p, end, m) ||
+			!tparse::getEdges(p, end, m, edges, std::thread::hardware_concurrency())) {
+			return false;
+		}
+		startTrace(n, edges);
+		while (readActionGroup(p, end)) {}
+		checkpointStep = std::max(64, getActionCount() / 256);
+		return true;
+	}
+
+	// follows a trace that is still being written (file or named pipe); pollLive picks
+	// up what has arrived, the groups are then stepped through as in any other trace
+	void openLive(const std::string& path) {
+		clear();
+		resetTrace();
+		trace.close();
+		checkpointStep = 64;
+		live.open(path);
+	}
+
+	// new groups since the last call
+	int pollLive() {
+		if (!live.isOpen()) {
+			return 0;
+		}
+		if (!liveStarted) {
+			int n;
+			std::vector <std::pair <int, int>> edges;
+			if (!live.takeHeader(n, edges)) {
+				return 0;
+			}
+			startTrace(n, edges);
+			liveStarted = true;
+		}
+		std::vector <std::vector <gtrace::Record>> groups;
+		live.takeGroups(groups);
+		for (const auto& group : groups) {
+			appendGroup(group);
+		}
+		return groups.size();
+	}
+	bool isLive() const {
+		return live.isOpen();
+	}
+
+	void clear() {
+		nodes.clear();
+		edges.clear();
+		node.clear();
+		edge.clear();
+		layout.clear();
+		grid.clear();
+		gridDirty = true;
+		maxRadius = 0;
+	}
+
+	// the first node under point, -1 if there is none
+	int getNodeAtPointInd(const sf::Vector2f& point) const {
+		refreshGrid();
+		int res = -1;
+		sf::FloatRect area(point.x - maxRadius, point.y - maxRadius, maxRadius * 2, maxRadius * 2);
+		grid.forEachInRect(area, [&](int i) {
+			if ((res == -1 || i < res) && nodes[node[i]].isContains(layout.getPos(i), point)) {
+				res = i;
+			}
+		});
+		return res;
+	}
+
+	// nodes with centers inside rect, in increasing order
+	std::vector <int> getNodesInRect(const sf::FloatRect& rect) const {
+		refreshGrid();
+		std::vector <int> res;
+		grid.forEachInRect(rect, [&](int i) {
+			if (rect.contains(layout.getPos(i))) {
+				res.push_back(i);
+			}
+		});
+		std::sort(res.begin(), res.end());
+		return res;
+	}
+
+	// nodes with centers inside the polygon (even-odd rule), in increasing order
+	std::vector <int> getNodesInPolygon(const std::vector <sf::Vector2f>& poly) const {
+		std::vector <int> res;
+		if (poly.size() < 3) {
+			return res;
+		}
+		sf::Vector2f mn = poly[0], mx = poly[0];
+		for (const auto& p : poly) {
+			mn.x = std::min(mn.x, p.x);
+			mn.y = std::min(mn.y, p.y);
+			mx.x = std::max(mx.x, p.x);
+			mx.y = std::max(mx.y, p.y);
+		}
+		refreshGrid();
+		grid.forEachInRect(sf::FloatRect(mn, mx - mn), [&](int i) {
+			sf::Vector2f p = layout.getPos(i);
+			bool inside = false;
+			for (int a = 0, b = poly.size() - 1; a < poly.size(); b = a++) {
+				if ((poly[a].y > p.y) != (poly[b].y > p.y) &&
+					p.x < poly[b].x + (poly[a].x - poly[b].x) * (p.y - poly[b].y) / (poly[a].y - poly[b].y)) {
+					inside = !inside;
+				}
+			}
+			if (inside) {
+				res.push_back(i);
+			}
+		});
+		std::sort(res.begin(), res.end());
+		return res;
+	}
+
+	sf::Vector2f getNodePos(int ind) const {
+		return layout.getPos(ind);
+	}
+	void setNodePos(int ind, const sf::Vector2f& pos) {
+		layout.setPos(ind, pos);
+		gridDirty = true;
+	}
+	void clearNodeVelocity(int ind) {
+		layout.clearVelocity(ind);
+	}
+
+	// every group of an opened trace is indexed or parsed by now
+	bool nextAction() {
+		if (curAction < getActionCount()) {
+			applyGroup(curAction++);
+			return true;
+		}
+		return false;
+	}
+
+	bool nextAction(std::istream& is) {
+		if (curAction == getActionCount()) {
+			readActionGroup(is);
+		}
+		if (curAction < getActionCount()) {
+			applyGroup(curAction++);
+			return true;
+		}
+		return false;
+	}
+
+	bool prevAction() {
+		if (curAction == 0) {
+			return false;
+		}
+		if (undoKnown[curAction - 1]) {
+			undoGroup(--curAction);
+		}
+		else {
+			seekAction(curAction - 1);
+		}
+		return true;
+	}
+
+	// state after the first target groups: undo a few steps back, or restore the
+	// nearest checkpoint before target and apply the groups after it
+	void seekAction(int target) {
+		target = std::max(0, std::min(target, getActionCount()));
+		if (target < curAction && curAction - target <= checkpointStep) {
+			bool known = true;
+			for (int g = target; g < curAction; ++g) {
+				known &= undoKnown[g] != 0;
+			}
+			if (known) {
+				while (curAction > target) {
+					undoGroup(--curAction);
+				}
+				return;
+			}
+		}
+		int k = std::min(target / checkpointStep, (int)checkpoints.size() - 1);
+		if (k >= 0 && (target < curAction || k * checkpointStep > curAction) && !restoreCheckpoint(k)) {
+			return;
+		}
+		while (curAction < target) {
+			applyGroup(curAction++);
+		}
+	}
+
+	int getActionCount() const {
+		return groupStart.size() - 1;
+	}
+	int getCurAction() const {
+		return curAction;
+	}
+
+	void addNode(const sf::Vector2f& pos) {
+		detachTrace();
+		node.push_back(newNode(nodeCnt + 1, 1));
+		layout.addNode(pos, 1);
+		++nodeCnt;
+		maxRadius = std::max(maxRadius, nodes[node.back()].getRadius());
+		gridDirty = true;
+	}
+
+	// O(degree): incident edges and then the node are swap-and-popped,
+	// the last edge and the last node take the freed indices
+	void deleteNode(int ind) {
+		if (ind < 0 || ind >= node.size()) return;
+		detachTrace();
+
+		while (!layout.getIncident(ind).empty()) {
+			removeEdge(layout.getIncident(ind).back());
+		}
+
+		if (grid.size() == node.size()) {
+			grid.remove(ind);
+		}
+		else {
+			grid.clear();
+		}
+		gridDirty = true;
+
+		nodes.release(node[ind]);
+		node[ind] = node.back();
+		node.pop_back();
+		layout.removeNode(ind);
+	}
+
+	// removes every edge between nd1 and nd2 if there is one, otherwise adds one
+	void swapEdge(int nd1, int nd2) {
+		if (nd1 < 0 || nd2 < 0 || nd1 >= node.size() || nd2 >= node.size()) {
+			return;
+		}
+		detachTrace();
+		if (layout.findSpring(nd1, nd2) != -1) {
+			for (int s; (s = layout.findSpring(nd1, nd2)) != -1; ) {
+				removeEdge(s);
+			}
+		}
+		else if (nd1 != nd2) {
+			edge.push_back(newEdge(1));
+			layout.addSpring(nd1, nd2, 200);
+		}
+	}
+
+	void renum() {
+		std::vector <int> nums;
+		for (auto h : node) {
+			nums.push_back(nodes[h].getNum());
+		}
+		std::sort(nums.begin(), nums.end());
+		nums.resize(std::unique(nums.begin(), nums.end()) - nums.begin());
+		for (auto h : node) {
+			nodes[h].setString(std::to_string(std::lower_bound(nums.begin(), nums.end(), nodes[h].getNum()) - nums.begin() + 1));
+		}
+		nodeCnt = node.size();
+	}
+
+	std::string toString() const {
+		std::vector <int> nums;
+		for (auto h : node) {
+			nums.push_back(nodes[h].getNum());
+		}
+		std::vector <int> sorted = nums;
+		std::sort(sorted.begin(), sorted.end());
+		sorted.resize(std::unique(sorted.begin(), sorted.end()) - sorted.begin());
+		// new number of every node, found once and not twice per edge
+		std::vector <int> rank(node.size());
+		for (int i = 0; i < node.size(); ++i) {
+			rank[i] = std::lower_bound(sorted.begin(), sorted.end(), nums[i]) - sorted.begin() + 1;
+		}
+
+		std::string str;
+		str = std::to_string(node.size()) + " " + std::to_string(edge.size()) + "\n";
+		str.reserve(str.size() + edge.size() * 16);
+		for (int i = 0; i < edge.size(); ++i) {
+			const Layout::Spring& sp = layout.getSpring(i);
+			str += std::to_string(rank[sp.u]);
+			str += ' ';
+			str += std::to_string(rank[sp.v]);
+			str += '\n';
+		}
+
+		return str;
+	}
+
+	// positions, colors, labels and the edges that are alive now, in the format of GraphSave.h
+	bool saveBinary(const std::string& path) const {
+		std::vector <int> alive;
+		for (int i = 0; i < edge.size(); ++i) {
+			if (layout.getSpring(i).alive) {
+				alive.push_back(i);
+			}
+		}
+		std::string buf(gsave::magic, 4);
+		buf.reserve(gsave::headerSize + node.size() * gsave::nodeSize + alive.size() * gsave::edgeSize);
+		buf += (char)gsave::version;
+		gsave::putU32(buf, node.size());
+		gsave::putU32(buf, alive.size());
+		gsave::putU32(buf, nodeCnt);
+		for (int i = 0; i < node.size(); ++i) {
+			sf::Vector2f pos = layout.getPos(i);
+			gsave::putFloat(buf, pos.x);
+			gsave::putFloat(buf, pos.y);
+			gsave::putU32(buf, nodes[node[i]].getColor().toInteger());
+			gsave::putU32(buf, nodes[node[i]].getNum());
+		}
+		for (int i : alive) {
+			const Layout::Spring& sp = layout.getSpring(i);
+			gsave::putU32(buf, sp.u);
+			gsave::putU32(buf, sp.v);
+			gsave::putU32(buf, edges[edge[i]].getColor().toInteger());
+		}
+
+		std::ofstream fout(path, std::ios::binary);
+		fout.write(buf.data(), buf.size());
+		return (bool)fout;
+	}
+
+	// the graph as saved by saveBinary, nodes start where they were
+	bool loadBinary(const std::string& path) {
+		MappedFile file;
+		if (!file.open(path) || !gsave::isSave(file.data(), file.size())) {
+			return false;
+		}
+		const char* p = file.data() + 5;
+		uint32_t n = gsave::getU32(p);
+		uint32_t m = gsave::getU32(p);
+		uint32_t next = gsave::getU32(p);
+		if (file.size() < gsave::headerSize + (uint64_t)n * gsave::nodeSize + (uint64_t)m * gsave::edgeSize) {
+			return false;
+		}
+
+		clear();
+		resetTrace();
+		layout.reserve(n, m);
+		float scale = layoutScale(n);
+		std::vector <sf::Uint32> nodeCol(n), nums(n);
+		for (uint32_t i = 0; i < n; ++i) {
+			float x = gsave::getFloat(p);
+			float y = gsave::getFloat(p);
+			layout.addNode({ x, y }, sqrt(scale));
+			nodeCol[i] = gsave::getU32(p);
+			nums[i] = gsave::getU32(p);
+		}
+		std::vector <std::pair <int, int>> ends;
+		std::vector <sf::Uint32> edgeCol;
+		ends.reserve(m);
+		edgeCol.reserve(m);
+		for (uint32_t i = 0; i < m; ++i) {
+			uint32_t u = gsave::getU32(p);
+			uint32_t v = gsave::getU32(p);
+			sf::Uint32 col = gsave::getU32(p);
+			if (u < n && v < n) {
+				ends.push_back({ u, v });
+				edgeCol.push_back(col);
+			}
+		}
+		layout.addSprings(ends, 200 * scale);
+
+		makeElements();
+		baseEdges = edge.size();
+		for (uint32_t i = 0; i < n; ++i) {
+			nodes[node[i]].setOutlineColor(sf::Color(nodeCol[i]));
+			nodes[node[i]].setString(std::to_string(nums[i]));
+		}
+		for (int i = 0; i < edge.size(); ++i) {
+			edges[edge[i]].setColor(sf::Color(edgeCol[i]));
+		}
+		nodeCnt = next;
+		return true;
+	}
+};
@@ -0,0 +1,500 @@
+#define SFML_STATIC
+
+#include <SFML/Graphics.hpp>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <cstdio>
+#include <cmath>
+
+#include "Graph.h"
+#include "GraphDrawer.h"
+
+// Benchmarks over synthetic graphs, one JSON object per measurement and line:
+//     GraphBench --sizes 1000,10000 --graphs grid,sf -o results.jsonl
+// {"bench":"step","graph":"grid","nodes":1024,"edges":1984,"value":0.82,"unit":"ms"}
+void usage() {
+	std::cerr << "usage: GraphBench [options]\n";
+	std::cerr << "    --sizes LIST       node counts (default 1000,10000,100000,1000000)\n";
+	std::cerr << "    --graphs LIST      er, grid, sf (scale-free), tree (default all)\n";
+	std::cerr << "    --steps N          physics steps to time (default 20)\n";
+	std::cerr << "    --all-pairs        all pairs repulsion instead of Barnes-Hut\n";
+	std::cerr << "    --threads N        physics threads (default: all cores)\n";
+	std::cerr << "    --events N         gdraw actions to write per run (default 1000000)\n";
+	std::cerr << "    --render N         also draw N frames into a 1920x1080 offscreen target\n";
+	std::cerr << "    --random           start from random points, not from the multilevel placement\n";
+	std::cerr << "    --seed S           seed of the generators (default 1)\n";
+	std::cerr << "    --tmp DIR          directory for temporary files (default .)\n";
+	std::cerr << "    -o FILE            write results to FILE instead of stdout\n";
+}
+
+struct Synthetic {
+	int n = 0;
+	std::vector <std::pair <int, int>> edges;
+};
+
+// Erdos-Renyi with average degree 4
+Synthetic makeRandom(int n) {
+	Synthetic g;
+	g.n = n;
+	for (int i = 0; i < n * 2 && n > 1; ++i) {
+		int u = rnd() % n, v = rnd() % (n - 1);
+		g.edges.push_back({ u, v >= u ? v + 1 : v });
+	}
+	return g;
+}
+
+Synthetic makeGrid(int n) {
+	Synthetic g;
+	int side = std::max((int)std::round(std::sqrt((double)n)), 1);
+	g.n = side * side;
+	for (int x = 0; x < side; ++x) {
+		for (int y = 0; y < side; ++y) {
+			if (x + 1 < side) {
+				g.edges.push_back({ x * side + y, (x + 1) * side + y });
+			}
+			if (y + 1 < side) {
+				g.edges.push_back({ x * side + y, x * side + y + 1 });
+			}
+		}
+	}
+	return g;
+}
+
+// Barabasi-Albert, every new node takes two edges to nodes picked by degree
+Synthetic makeScaleFree(int n) {
+	Synthetic g;
+	g.n = n;
+	std::vector <int> ends;
+	for (int v = 1; v < n; ++v) {
+		for (int k = 0; k < std::min(v, 2); ++k) {
+			int u = ends.empty() ? 0 : ends[rnd() % ends.size()];
+			g.edges.push_back({ u, v });
+			ends.push_back(u);
+			ends.push_back(v);
+		}
+	}
+	return g;
+}
+
+// random recursive tree
+Synthetic makeTree(int n) {
+	Synthetic g;
+	g.n = n;
+	for (int v = 1; v < n; ++v) {
+		g.edges.push_back({ (int)(rnd() % v), v });
+	}
+	return g;
+}
+
+bool makeGraph(const std::string& name, int n, Synthetic& g) {
+	if (name == "er") {
+		g = makeRandom(n);
+	}
+	else if (name == "grid") {
+		g = makeGrid(n);
+	}
+	else if (name == "sf") {
+		g = makeScaleFree(n);
+	}
+	else if (name == "tree") {
+		g = makeTree(n);
+	}
+	else {
+		return false;
+	}
+	return true;
+}
+
+std::vector <std::string> splitList(const std::string& s) {
+	std::vector <std::string> res;
+	std::stringstream ss(s);
+	std::string item;
+	while (std::getline(ss, item, ',')) {
+		if (!item.empty()) {
+			res.push_back(item);
+		}
+	}
+	return res;
+}
+
+double since(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration <double>(std::chrono::steady_clock::now() - start).count();
+}
+
+class Report {
+private:
+	std::ostream& os;
+	std::string graph;
+	int nodes = 0;
+	int edges = 0;
+
+public:
+	Report(std::ostream& _os) : os(_os) {}
+
+	void setGraph(const std::string& name, int n, int m) {
+		graph = name;
+		nodes = n;
+		edges = m;
+	}
+
+	void add(const std::string& bench, double value, const std::string& unit) {
+		os << "{\"bench\":\"" << bench << "\",\"graph\":\"" << graph << "\",\"nodes\":" << nodes << ",\"edges\":" << edges
+			<< ",\"value\":" << value << ",\"unit\":\"" << unit << "\"}" << std::endl;
+		std::cerr << "    " << bench << ": " << value << ' ' << unit << '\n';
+	}
+};
+
+// actions of a colouring run in groups of 16, half on nodes and half on edges
+void writeActions(const Synthetic& g, int events) {
+	const int group = 16;
+	for (int i = 0; i < events; i += group) {
+		gdraw::setBlockSize(std::min(group, events - i));
+		for (int k = 0; k < group && i + k < events; ++k) {
+			unsigned int c = rnd() & 255;
+			if (k % 2 == 0 || g.edges.empty()) {
+				gdraw::changeNodeColor(rnd() % g.n, c, 255 - c, 0);
+			}
+			else {
+				gdraw::changeEdgeColor(rnd() % g.edges.size(), 0, c, 255 - c);
+			}
+		}
+	}
+}
+
+// a text graph or log read with iostream extraction and out of a mapping with from_chars
+// (edges on threads threads), in MB/s of the whole file: header, edges and action groups
+void benchParse(const std::string& path, const std::string& name, int threads, Report& report) {
+	MappedFile file;
+	if (!file.open(path)) {
+		std::cerr << "|ERROR| GraphBench: can't open " << path << '\n';
+		return;
+	}
+	double mb = file.size() / 1e6;
+
+	auto start = std::chrono::steady_clock::now();
+	size_t streamRecords = 0;
+	{
+		std::ifstream fin(path);
+		int n, m, k;
+		fin >> n >> m;
+		std::vector <std::pair <int, int>> edges(m);
+		for (auto& [u, v] : edges) {
+			fin >> u >> v;
+		}
+		while (fin >> k) {
+			for (int i = 0; i < k; ++i) {
+				gtrace::Record rec;
+				streamRecords += gtrace::readText(fin, rec);
+			}
+		}
+	}
+	report.add(name + "_parse_stream", mb / since(start), "MB/s");
+
+	start = std::chrono::steady_clock::now();
+	size_t mappedRecords = 0;
+	{
+		const char* p = file.data();
+		const char* end = p + file.size();
+		int n, m, k;
+		std::vector <std::pair <int, int>> edges;
+		tparse::getInt(p, end, n);
+		tparse::getInt(p, end, m);
+		tparse::getEdges(p, end, m, edges, threads);
+		while (tparse::getInt(p, end, k)) {
+			for (int i = 0; i < k; ++i) {
+				gtrace::Record rec;
+				mappedRecords += tparse::getRecord(p, end, rec);
+			}
+		}
+	}
+	report.add(name + "_parse_mapped", mb / since(start), "MB/s");
+	if (streamRecords != mappedRecords) {
+		std::cerr << "|ERROR| GraphBench: " << streamRecords << " records read as a stream, " << mappedRecords << " mapped\n";
+	}
+}
+
+// gdraw throughput in every mode and the parse of the text log, the binary trace is left at path for the replay
+void benchGdraw(const Synthetic& g, int events, const std::string& path, int threads, Report& report) {
+	struct Mode {
+		const char* name;
+		gdraw::Format format;
+		bool async;
+	};
+	for (Mode mode : { Mode{ "gdraw_text", gdraw::Format::Text, false },
+		Mode{ "gdraw_binary_async", gdraw::Format::Binary, true },
+		Mode{ "gdraw_binary", gdraw::Format::Binary, false } }) {
+		gdraw::setFormat(mode.format);
+		gdraw::init(path, g.n, g.edges);
+
+		auto start = std::chrono::steady_clock::now();
+		if (mode.async) {
+			gdraw::startAsync();
+		}
+		writeActions(g, events);
+		gdraw::reset();
+		report.add(mode.name, events / since(start), "events/s");
+		if (mode.format == gdraw::Format::Text) {
+			benchParse(path, "trace", threads, report);
+		}
+	}
+}
+
+// the graph of path laid out on the simulation thread over a board that is not the default
+// one for at most two seconds, every node has to stay on the caller's board
+void benchSimulation(const std::string& path, int threads, Report& report) {
+	const sf::Vector2f board(1000, 800);
+	Graph graph;
+	graph.setBoard(board, board / 10.f);
+	graph.setThreads(threads);
+	graph.setRepulsion(Layout::Repulsion::BarnesHut);
+	if (!graph.loadText(path)) {
+		std::cerr << "|ERROR| GraphBench: can't open " << path << '\n';
+		return;
+	}
+	graph.setSimulationThread(true);
+	auto start = std::chrono::steady_clock::now();
+	while (since(start) < 2) {
+		graph.update(1 / 60.f);
+		if (graph.isSleeping()) {
+			break;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(16));
+	}
+	int outside = 0;
+	for (int i = 0; i < graph.getLayout().size(); ++i) {
+		sf::Vector2f p = graph.getNodePos(i);
+		outside += !(p.x >= 0 && p.y >= 0 && p.x <= board.x && p.y <= board.y);
+	}
+	report.add("simulation_outside", outside, "nodes");
+	if (outside > 0) {
+		std::cerr << "|ERROR| GraphBench: " << outside << " nodes left the board on the simulation thread\n";
+	}
+}
+
+void benchReplay(const std::string& path, Graph& graph, Report& report) {
+	auto start = std::chrono::steady_clock::now();
+	if (!graph.openTrace(path)) {
+		std::cerr << "|ERROR| GraphBench: can't open " << path << '\n';
+		return;
+	}
+	report.add("trace_open", since(start), "s");
+
+	int count = graph.getActionCount();
+	int groups = 0;
+	start = std::chrono::steady_clock::now();
+	while (graph.getCurAction() < count) {
+		graph.nextAction();
+		++groups;
+	}
+	report.add("replay_forward", groups / since(start), "groups/s");
+
+	start = std::chrono::steady_clock::now();
+	while (graph.getCurAction() > 0) {
+		graph.prevAction();
+	}
+	report.add("replay_backward", groups / since(start), "groups/s");
+
+	start = std::chrono::steady_clock::now();
+	const int seeks = 1000;
+	for (int i = 0; i < seeks; ++i) {
+		graph.seekAction(rnd() % (count + 1));
+	}
+	report.add("replay_seek", since(start) / seeks * 1000, "ms");
+}
+
+// a trace that deletes the same few edges again and again, every group undone one by one
+// has to leave them as a seek from a checkpoint does
+void checkUndo(const Synthetic& g, const std::string& path, Report& report) {
+	const int groups = 300;
+	const int touched = std::min((int)g.edges.size(), 16);
+	if (touched == 0) {
+		return;
+	}
+	{
+		std::ofstream fout(path);
+		fout << g.n << ' ' << g.edges.size() << '\n';
+		for (auto [u, v] : g.edges) {
+			fout << u + 1 << ' ' << v + 1 << '\n';
+		}
+		for (int i = 0; i < groups; ++i) {
+			fout << "2\ned " << rnd() % touched + 1 << "\nnc " << rnd() % g.n + 1 << ' ' << (rnd() & 0xffffff) << '\n';
+		}
+	}
+	Graph undone, seeked;
+	if (!undone.openTrace(path) || !seeked.openTrace(path)) {
+		std::cerr << "|ERROR| GraphBench: can't open " << path << '\n';
+		return;
+	}
+	int count = undone.getActionCount();
+	undone.seekAction(count);
+	seeked.seekAction(count);
+	int mismatches = 0;
+	while (undone.getCurAction() > 0) {
+		undone.prevAction();
+		seeked.seekAction(0);
+		seeked.seekAction(undone.getCurAction());
+		for (int i = 0; i < touched; ++i) {
+			mismatches += undone.getLayout().getSpring(i).alive != seeked.getLayout().getSpring(i).alive;
+		}
+	}
+	report.add("undo_mismatch", mismatches, "edges");
+	if (mismatches > 0) {
+		std::cerr << "|ERROR| GraphBench: " << mismatches << " edges differ between undo and seek\n";
+	}
+}
+
+int main(int argc, char* argv[]) {
+	std::vector <int> sizes = { 1000, 10000, 100000, 1000000 };
+	std::vector <std::string> graphs = { "er", "grid", "sf", "tree" };
+	int steps = 20;
+	bool allPairs = false;
+	int threads = std::thread::hardware_concurrency();
+	int events = 1000000;
+	int renderFrames = 0;
+	bool multilevel = true;
+	std::string tmp = ".";
+	std::string output;
+	rnd.seed(1);
+
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		bool hasNext = i + 1 < argc;
+		if (arg == "--sizes" && hasNext) {
+			sizes.clear();
+			for (const auto& s : splitList(argv[++i])) {
+				sizes.push_back(std::stoi(s));
+			}
+		}
+		else if (arg == "--graphs" && hasNext) {
+			graphs = splitList(argv[++i]);
+		}
+		else if (arg == "--steps" && hasNext) {
+			steps = std::stoi(argv[++i]);
+		}
+		else if (arg == "--all-pairs") {
+			allPairs = true;
+		}
+		else if (arg == "--threads" && hasNext) {
+			threads = std::stoi(argv[++i]);
+		}
+		else if (arg == "--events" && hasNext) {
+			events = std::stoi(argv[++i]);
+		}
+		else if (arg == "--render" && hasNext) {
+			renderFrames = std::stoi(argv[++i]);
+		}
+		else if (arg == "--random") {
+			multilevel = false;
+		}
+		else if (arg == "--seed" && hasNext) {
+			rnd.seed(std::stoul(argv[++i]));
+		}
+		else if (arg == "--tmp" && hasNext) {
+			tmp = argv[++i];
+		}
+		else if (arg == "-o" && hasNext) {
+			output = argv[++i];
+		}
+		else {
+			usage();
+			return 1;
+		}
+	}
+
+	std::ofstream fout;
+	if (!output.empty()) {
+		fout.open(output);
+		if (!fout) {
+			std::cerr << "|ERROR| GraphBench: can't open " << output << '\n';
+			return 1;
+		}
+	}
+	Report report(output.empty() ? std::cout : fout);
+	std::string tracePath = tmp + "/GraphBench.trace";
+	std::string textPath = tmp + "/GraphBench.txt";
+	sf::Vector2f boardSize(1920, 1080);
+
+	sf::Font font;
+	sf::RenderTexture target;
+	if (renderFrames > 0) {
+		font.loadFromFile("font/arialmt.ttf");
+		if (!target.create(boardSize.x, boardSize.y)) {
+			std::cerr << "|ERROR| GraphBench: can't create offscreen target\n";
+			renderFrames = 0;
+		}
+	}
+
+	for (const auto& name : graphs) {
+		for (int n : sizes) {
+			Synthetic g;
+			if (!makeGraph(name, n, g)) {
+				std::cerr << "|ERROR| GraphBench: unknown graph " << name << '\n';
+				return 1;
+			}
+			report.setGraph(name, g.n, g.edges.size());
+			std::cerr << name << ", " << g.n << " nodes, " << g.edges.size() << " edges\n";
+
+			std::ostringstream text;
+			text << g.n << ' ' << g.edges.size() << '\n';
+			for (auto [u, v] : g.edges) {
+				text << u + 1 << ' ' << v + 1 << '\n';
+			}
+			std::istringstream is(text.str());
+			{
+				std::ofstream fout(textPath);
+				fout << text.str();
+			}
+			text.str("");
+
+			Graph graph;
+			if (renderFrames > 0) {
+				graph.setFont(font);
+			}
+			graph.setBoard(boardSize, boardSize / 10.f);
+			graph.setThreads(threads);
+			graph.setMultilevel(multilevel);
+			graph.setRepulsion(allPairs ? Layout::Repulsion::AllPairs : Layout::Repulsion::BarnesHut);
+
+			auto start = std::chrono::steady_clock::now();
+			is >> graph;
+			report.add("load", since(start), "s");
+
+			benchParse(textPath, "edges", threads, report);
+			start = std::chrono::steady_clock::now();
+			graph.loadText(textPath);
+			report.add("load_text", since(start), "s");
+			benchSimulation(textPath, threads, report);
+			std::remove(textPath.c_str());
+
+			start = std::chrono::steady_clock::now();
+			for (int i = 0; i < steps; ++i) {
+				graph.step(1 / 60.f);
+			}
+			report.add("step", steps > 0 ? since(start) / steps * 1000 : 0, "ms");
+
+			if (renderFrames > 0) {
+				start = std::chrono::steady_clock::now();
+				for (int i = 0; i < renderFrames; ++i) {
+					target.clear();
+					target.draw(graph);
+					target.display();
+				}
+				report.add("render", since(start) / renderFrames * 1000, "ms");
+			}
+
+			if (events > 0) {
+				benchGdraw(g, events, tracePath, threads, report);
+				benchReplay(tracePath, graph, report);
+				checkUndo(g, tracePath, report);
+				std::remove(tracePath.c_str());
+			}
+		}
+	}
+
+	return 0;
+}
@@ -3,621 +3,297 @@
 #include <SFML/Graphics.hpp>
 #include <fstream>
 #include <vector>
-#include <chrono>
-#include <random>
 #include <string>
-#include <sstream>
 #include <iostream>
-#include <set>
 #include <algorithm>
 #include <filesystem>
+#include <thread>
+#include <cmath>
+#include <cctype>
+#include <ctime>
+#include <cstdio>
 
-std::mt19937 rnd(std::chrono::high_resolution_clock::now().time_since_epoch().count());
-float rnd01() {
-	return (double)rnd() / rnd.max();
-}
-
-const float force = 3;
-
-sf::Vector2f boardSize;
-sf::Vector2f boardOffset;
-
-float length(const sf::Vector2f& vec) {
-	return sqrt(vec.x * vec.x + vec.y * vec.y);
-}
+#include "Graph.h"
+#include "ImageSaver.h"
+#include "SavesIndex.h"
 
-class Node : public sf::Drawable {
+// Saves are binary .graph files with the layout, older .txt ones hold only the edges.
+class SavesMenu {
 private:
-	sf::Vector2f pos;
-	sf::Color fillCol;
-	sf::Color outlineCol;
-	float size = 0;
-	float outlineSize = 0;
-	sf::Vector2f velocity;
+	SavesIndex index;
+	std::vector <SavesIndex::Entry> entries; // what the index had at version
+	int version = -1;
+	int curPos = 0;
 	sf::Font font;
-	std::string str;
-	float scale = 1;
+	sf::Texture thumb;
+	std::string thumbFile; // entry the thumb texture was made for
 
-	friend class Edge;
-
-public:
-	void draw(sf::RenderTarget& window, sf::RenderStates states) const {
-		sf::CircleShape shape;
-		shape.setPosition(pos);
-		shape.setRadius(size);
-		shape.setOutlineThickness(outlineSize);
-		shape.setFillColor(fillCol);
-		shape.setOutlineColor(outlineCol);
-		shape.setOrigin({ size, size });
-
-		window.draw(shape, states);
-
-		if (!str.empty()) {
-			sf::Text text;
-			text.setFont(font);
-			text.setString(str);
-			text.setCharacterSize(20);
-			text.setOutlineThickness(2);
-			text.setFillColor({ 255, 255, 255 });
-			text.setOutlineColor({ 20, 20, 20 });
-			
-			float sz = std::max(text.getGlobalBounds().width, text.getGlobalBounds().height);
-			if (sz > 0) {
-				text.scale({ size * 1.3f / sz, size * 1.3f / sz });
-				text.setPosition(pos - sf::Vector2f(text.getGlobalBounds().width, text.getGlobalBounds().height) / 2.0f);
-				window.draw(text);
-			}
+	// takes the latest entries of the index, the selection stays on the same file
+	void update() {
+		if (index.getVersion() == version) {
+			return;
 		}
-	}
-
-	void interact(Node& other, float time) {
-		float d = length(pos - other.pos);
-		d /= scale;
-		d /= 100;
-		if (d > 0) {
-			velocity += (pos - other.pos) / d * (force / d) * time;
-			other.velocity += (other.pos - pos) / d * (force / d) * time;
+		version = index.getVersion();
+		std::string cur = entries.empty() ? "" : entries[curPos].file;
+		entries = index.getEntries();
+		curPos = 0;
+		for (int i = 0; i < entries.size(); ++i) {
+			if (entries[i].file == cur) {
+				curPos = i;
+			}
 		}
+		thumbFile.clear();
 	}
 
-	void update(float time) {
-		if (pos.x < boardOffset.x) {
-			velocity.x += (boardOffset.x - pos.x) * (boardOffset.x - pos.x) * force * time * 4.f;
-		}
-		if (pos.x > boardSize.x - boardOffset.x) {
-			velocity.x -= (pos.x - boardSize.x + boardOffset.x) * (pos.x - boardSize.x + boardOffset.x) * force * time * 4.f;
-		}
-		if (pos.y < boardOffset.y) {
-			velocity.y += (boardOffset.y - pos.y) * (boardOffset.y - pos.y) * force * time * 4.f;
+	void updateThumb() {
+		const SavesIndex::Entry& e = entries[curPos];
+		if (thumbFile == e.file || e.thumb.empty()) {
+			return;
 		}
-		if (pos.y > boardSize.y - boardOffset.y) {
-			velocity.y -= (pos.y - boardSize.y + boardOffset.y) * (pos.y - boardSize.y + boardOffset.y) * force * time * 4.f;
+		thumbFile = e.file;
+		sf::Image image;
+		image.create(SavesIndex::thumbSize, SavesIndex::thumbSize);
+		for (int y = 0; y < SavesIndex::thumbSize; ++y) {
+			for (int x = 0; x < SavesIndex::thumbSize; ++x) {
+				unsigned char v = e.thumb[y * SavesIndex::thumbSize + x];
+				image.setPixel(x, y, { v, v, v });
+			}
 		}
-
-		velocity -= (pos - boardSize / 2.0f) / scale * force / 3.0f * time;
-
-		pos += velocity * time;
-		velocity *= exp(-time);
+		thumb.loadFromImage(image);
 	}
 
-	void setPos(const sf::Vector2f& vec) {
-		pos = vec;
-	}
-	void setFillColor(const sf::Color& col) {
-		fillCol = col;
-	}
-	void setOutlineColor(const sf::Color& col) {
-		outlineCol = col;
-	}
-	void setSize(float sz) {
-		size = sz;
-	}
-	void setOutlineSize(float sz) {
-		outlineSize = sz;
-	}
-	void setFont(const sf::Font& _font) {
-		font = _font;
-	}
-	void setString(const std::string& text) {
-		str = text;
-	}
-	void setScale(float sc) {
-		scale = sc;
-	}
+public:
+	SavesMenu() : index(std::filesystem::current_path().string() + "\\saves\\") {}
 
-	bool isContains(const sf::Vector2f& point) {
-		return length(point - pos) <= size + outlineSize;
+	// the directory is scanned again in the background, the menu shows the old list until then
+	void reload() {
+		index.refresh();
 	}
 
-	sf::Vector2f getPos() {
-		return pos;
+	// the index has entries the menu has not shown yet
+	bool hasUpdate() const {
+		return index.getVersion() != version;
 	}
-	sf::Color getColor() {
-		return outlineCol;
+	bool isScanning() const {
+		return index.isScanning();
 	}
 
-	void clearVelocity() {
-		velocity = { 0.f, 0.f };
+	static std::string displayName(const std::string& file) {
+		std::filesystem::path path(file);
+		return path.stem().string() + (path.extension() == ".txt" ? " (edges only)" : "");
 	}
 
-	int getNum() {
-		return std::stoi(str);
+	void movePos(int val) {
+		update();
+		curPos += val;
+		curPos = std::max(std::min(curPos, (int)entries.size() - 1), 0);
 	}
-};
-
-class Edge : public sf::Drawable {
-private:
-	Node* nd1 = nullptr;
-	Node* nd2 = nullptr;
-
-	sf::Color col;
-	float size = 3;
-	float optLen = 0;
-	bool alive = true;
 
-public:
-	void interact(float time) {
-		if (alive) {
-			float d0 = length(nd1->pos - nd2->pos);
-			float d = d0 - optLen;
-			nd1->velocity += ((nd2->pos - nd1->pos) / d0) * force * time * d;
-			nd2->velocity += ((nd1->pos - nd2->pos) / d0) * force * time * d;
-		}
+	void setFont(const sf::Font& _font) {
+		font = _font;
 	}
 
-	void draw(sf::RenderTarget& window, sf::RenderStates states) const {
-		if (alive) {
-			sf::Vector2f vec = nd1->pos - nd2->pos;
-			vec /= length(vec);
-			vec = sf::Vector2f(-vec.y, vec.x);
-
-			sf::ConvexShape shape;
-			shape.setPointCount(4);
-			shape.setPoint(0, nd1->pos + vec * size);
-			shape.setPoint(1, nd1->pos - vec * size);
-			shape.setPoint(2, nd2->pos - vec * size);
-			shape.setPoint(3, nd2->pos + vec * size);
-			shape.setFillColor(col);
-
-			window.draw(shape, states);
+	void draw(sf::RenderWindow& window) {
+		update();
+		sf::Text text;
+		text.setFont(font);
+		text.setFillColor({ 255, 255, 255 });
+		text.setOutlineThickness(2);
+		text.setOutlineColor({ 50, 50, 50 });
+		if (entries.empty()) {
+			text.setString(!index.isScanned() ? "Reading saves..." : "No saves");
+			text.setCharacterSize(30);
+			window.draw(text);
+			return;
 		}
-	}
-
-	void setFirstNode(Node* nd) {
-		nd1 = nd;
-	}
-	void setSecondNode(Node* nd) {
-		nd2 = nd;
-	}
-	void setColor(const sf::Color& color) {
-		col = color;
-	}
-	void setSize(float sz) {
-		size = sz;
-	}
-	void setOptLen(float ln) {
-		optLen = ln;
-	}
-	void setAlive(bool _alive) {
-		alive = _alive;
-	}
-	Node* getFirstNode() {
-		return nd1;
-	}
-	Node* getSecondNode() {
-		return nd2;
-	}
-
-	sf::Color getColor() {
-		return col;
-	}
-};
-
-sf::Color eBaseCol(100, 100, 100);
-
-class Graph : public sf::Drawable {
-private:
-	float scale = 1;
+		std::string str;
+		for (int i = -2; i <= std::min(2, (int)entries.size() - curPos - 1); ++i) {
+			if (i == 0) {
+				str += "> " + displayName(entries[curPos].file);
+			}
+			else if (curPos + i >= 0) {
+				str += displayName(entries[curPos + i].file);
+			}
+			str += '\n';
+		}
+		text.setString(str);
+		text.setCharacterSize(30);
+		window.draw(text);
 
-	std::vector <Node*> node;
-	std::vector <Edge*> edge;
-	std::set <std::pair <Node*, Node*>> st;
-	sf::Font font;
+		const SavesIndex::Entry& e = entries[curPos];
+		text.setString(std::to_string(e.nodes) + " nodes, " + std::to_string(e.edges) + " edges");
+		text.setCharacterSize(20);
+		text.setPosition(0, 190);
+		window.draw(text);
 
-	std::vector <std::vector <std::string>> actions;
-	std::vector <std::vector <std::string>> rActions;
-	int curAction = 0;
-	int nodeCnt = 0;
-
-	std::string rAction(const std::string& action) const {
-		std::stringstream ss(action);
-		std::string ans;
-
-		std::string type;
-		ss >> type;
-		if (type == "nc") {
-			int v;
-			ss >> v;
-			ans = "nc " + std::to_string(v) + ' ';
-			ans += std::to_string(node[(long long)v - 1]->getColor().toInteger());
-		}
-		if (type == "ec") {
-			int v;
-			ss >> v;
-			ans = "ec " + std::to_string(v) + ' ';
-			ans += std::to_string(edge[(long long)v - 1]->getColor().toInteger());
-		}
-		if (type == "ea") {
-			int u, v;
-			ss >> u >> v;
-			ans = "popEdge " + std::to_string(v) + ' ';
-		}
-		if (type == "ed") {
-			int eg;
-			ss >> eg;
-			ans = "setAliveTrue " + std::to_string(eg) + ' ';
-		}
-
-		return ans;
+		updateThumb();
+		if (thumbFile == e.file) {
+			sf::Sprite sprite(thumb);
+			sprite.setPosition(0, 225);
+			sprite.setScale(4, 4);
+			window.draw(sprite);
+		}
 	}
 
-	void readActionGroup(std::istream& is) {
-		int n;
-		if (!(is >> n)) {
+	void loadGraph(Graph& graph) {
+		update();
+		if (entries.empty()) {
 			return;
 		}
-		is.get();
-		actions.push_back({});
-		rActions.push_back({});
-		for (int i = 0; i < n; ++i) {
-			std::string s;
-			getline(is, s);
-			actions.back().push_back(s);
-			rActions.back().push_back(rAction(s));
+		std::string path = "saves\\" + entries[curPos].file;
+		bool binary = std::filesystem::path(path).extension() == ".graph";
+		if (!(binary ? graph.loadBinary(path) : graph.loadText(path))) {
+			std::cerr << "|ERROR| GraphDrawer: can't load " << path << '\n';
 		}
 	}
 
-	void doAction(const std::string& action) {
-		std::stringstream ss(action);
-
-		std::string type;
-		ss >> type;
-		if (type == "nc") {
-			int v;
-			ss >> v;
-			unsigned int col;
-			ss >> col;
-			node[(long long)v - 1]->setOutlineColor(sf::Color(col));
-		}
-		if (type == "ec") {
-			int v;
-			ss >> v;
-			unsigned int col;
-			ss >> col;
-			edge[(long long)v - 1]->setColor(sf::Color(col));
-		}
-		if (type == "ea") {
-			int u, v;
-			ss >> u >> v;
-			--u; --v;
-			Edge eg;
-			eg.setFirstNode(node[u]);
-			eg.setSecondNode(node[v]);
-
-			eg.setSize(3 * scale);
-			eg.setOptLen(200 * scale);
-			eg.setColor(eBaseCol);
-
-			edge.push_back(new Edge(eg));
-		}
-		if (type == "ed") {
-			int eg;
-			ss >> eg;
-			edge[(long long)eg - 1]->setAlive(false);
-		}
-		if (type == "popEdge") {
-			edge.pop_back();
-		}
-		if (type == "setAliveTrue") {
-			int eg;
-			ss >> eg;
-			edge[(long long)eg - 1]->setAlive(true);
+	void saveGraph(const Graph& graph, const std::string& saveName) {
+		if (!graph.saveBinary("saves\\" + saveName + ".graph")) {
+			std::cerr << "|ERROR| GraphDrawer: can't save " << saveName << '\n';
 		}
 	}
+};
 
-public:
-	~Graph() {
-		clear();
-	}
+// Bar at the bottom of the screen that shows and sets the current action group of a trace.
+class Timeline {
+private:
+	sf::FloatRect bar;
+	sf::Font font;
 
+public:
 	void setFont(const sf::Font& _font) {
 		font = _font;
 	}
 
-	void update(float time) {
-		for (auto nd1 : node) {
-			for (auto nd2 : node) {
-				nd1->interact(*nd2, time);
-			}
-		}
-		for (auto eg : edge) {
-			eg->interact(time);
-		}
-		for (auto nd : node) {
-			nd->update(time);
-		}
-	}
-
-	void draw(sf::RenderTarget& window, sf::RenderStates states) const {
-		for (auto eg : edge) {
-			window.draw(*eg, states);
-		}
-		for (auto nd : node) {
-			window.draw(*nd, states);
-		}
-	}
-
-	friend std::istream& operator>>(std::istream& is, Graph& graph) {
-		graph.clear();
-
-		int n, m;
-		is >> n >> m;
-		float scale = 1.f;
-		if (n != 0) {
-			scale = std::min(20.f / n, 1.f);
-		}
-		//graph.scale = scale;
-		for (int i = 0; i < n; ++i) {
-			Node nd;
-
-			nd.setPos({
-				rnd01() * (boardSize.x - 2 * boardOffset.x) + boardOffset.x,
-				rnd01() * (boardSize.y - 2 * boardOffset.y) + boardOffset.y });
-			nd.setSize(std::max(26 * scale, 9.f));
-			nd.setFillColor({ 50, 50, 50 });
-			nd.setOutlineSize(std::max(4 * scale, 1.f));
-			nd.setOutlineColor({ 255, 255, 255 });
-			nd.setFont(graph.font);
-			nd.setString(std::to_string(i + 1));
-			nd.setScale(sqrt(scale));
-
-			graph.node.push_back(new Node(nd));
-		}
-		for (int i = 0; i < m; ++i) {
-			Edge eg;
-			int u, v;
-			is >> u >> v;
-			--u; --v;
-			eg.setFirstNode(graph.node[u]);
-			eg.setSecondNode(graph.node[v]);
-
-			eg.setSize(3 * scale);
-			eg.setOptLen(200 * scale);
-			eg.setColor(eBaseCol);
-
-			graph.edge.push_back(new Edge(eg));
-		}
-
-		graph.nodeCnt = n;
-
-		return is;
+	void setWindowSize(const sf::Vector2f& size) {
+		bar = sf::FloatRect(size.x * 0.1f, size.y - 40, size.x * 0.8f, 10);
 	}
 
-	void clear() {
-		for (auto nd : node) {
-			delete nd;
-		}
-		for (auto eg : edge) {
-			delete eg;
-		}
-
-		node.clear();
-		edge.clear();
+	bool isContains(const sf::Vector2f& point) const {
+		return point.x >= bar.left && point.x <= bar.left + bar.width && std::abs(point.y - (bar.top + bar.height / 2)) <= 15;
 	}
 
-	Node* getNodeAtPoint(const sf::Vector2f& point) const {
-		for (auto nd : node) {
-			if (nd->isContains(point)) {
-				return nd;
-			}
-		}
-		return nullptr;
-	}
-	int getNodeAtPointInd(const sf::Vector2f& point) const {
-		for (int i = 0; i < node.size(); ++i) {
-			if (node[i]->isContains(point)) {
-				return i;
-			}
-		}
-		return -1;
+	int actionAt(float x, int count) const {
+		float part = std::min(std::max((x - bar.left) / bar.width, 0.f), 1.f);
+		return std::round(part * count);
 	}
 
-	bool nextAction(std::istream& is) {
-		if (curAction == actions.size()) {
-			readActionGroup(is);
-		}
-		if (curAction < actions.size()) {
-			for (const auto& s : actions[curAction]) {
-				doAction(s);
-			}
-			++curAction;
-			return true;
+	void draw(sf::RenderWindow& window, int cur, int count) {
+		if (count == 0) {
+			return;
 		}
-		return false;
-	}
+		sf::RectangleShape back({ bar.width, bar.height });
+		back.setPosition(bar.left, bar.top);
+		back.setFillColor({ 60, 60, 60 });
+		window.draw(back);
 
-	bool prevAction() {
-		if (curAction > 0) {
-			--curAction;
-			for (const auto& s : rActions[curAction]) {
-				doAction(s);
-			}
-			return true;
-		}
-		return false;
-	}
+		sf::RectangleShape done({ bar.width * cur / count, bar.height });
+		done.setPosition(bar.left, bar.top);
+		done.setFillColor({ 200, 200, 200 });
+		window.draw(done);
 
-	void addNode(const sf::Vector2f& pos) {
-		Node nd;
-		nd.setPos(pos);
-		nd.setString(std::to_string(nodeCnt + 1));
-		nd.setScale(1);
-		nd.setSize(std::max(26.f, 9.f));
-		nd.setFillColor({ 50, 50, 50 });
-		nd.setOutlineSize(std::max(4.f, 1.f));
-		nd.setOutlineColor({ 255, 255, 255 });
-		nd.setFont(font);
-		node.push_back(new Node(nd));
-		++nodeCnt;
+		sf::Text text;
+		text.setFont(font);
+		text.setString(std::to_string(cur) + " / " + std::to_string(count));
+		text.setFillColor({ 255, 255, 255 });
+		text.setCharacterSize(20);
+		text.setOutlineThickness(2);
+		text.setOutlineColor({ 50, 50, 50 });
+		text.setPosition(bar.left, bar.top - 30);
+		window.draw(text);
 	}
+};
 
-	void deleteNode(int ind) {
-		if (ind < 0 || ind >= node.size()) return;
-
-		std::vector <std::pair <Node*, Node*>> del1;
-		std::vector <int> deli;
-		for (int i = edge.size() - 1; i >= 0; --i) {
-			if (edge[i]->getFirstNode() == node[ind] || edge[i]->getSecondNode() == node[ind]) {
-				deli.push_back(i);
-			}
-		}
-		for (auto [f, s] : st) {
-			if (f == node[ind] || s == node[ind]) {
-				del1.push_back({ f, s });
-			}
-		}
-
-		for (auto i : deli) {
-			delete edge[i];
-			edge.erase(edge.begin() + i);
-		}
-		for (auto [f, s] : del1) {
-			st.erase({ f, s });
-		}
+// Percentiles of the time every profiled phase took in the last frames.
+class ProfileOverlay {
+private:
+	sf::Font font;
 
-		delete node[ind];
-		node.erase(node.begin() + ind);
+	void drawText(sf::RenderWindow& window, const std::string& str, float x, float y) {
+		sf::Text text;
+		text.setFont(font);
+		text.setString(str);
+		text.setFillColor({ 255, 255, 255 });
+		text.setCharacterSize(20);
+		text.setOutlineThickness(2);
+		text.setOutlineColor({ 50, 50, 50 });
+		text.setPosition(x, y);
+		window.draw(text);
 	}
 
-	void swapEdge(Node* nd1, Node* nd2) {
-		if (st.count({ nd1, nd2 }) || st.count({ nd2, nd1 })) {
-			st.erase({ nd1, nd2 });
-			st.erase({ nd2, nd1 });
-			for (int i = 0; i < edge.size(); ++i) {
-				if (edge[i]->getFirstNode() == nd1 && edge[i]->getSecondNode() == nd2 || edge[i]->getFirstNode() == nd2 && edge[i]->getSecondNode() == nd1) {
-					edge.erase(edge.begin() + i);
-				}
-			}
-		}
-		else if (nd1 != nd2) {
-			Edge* eg = new Edge;
-			eg->setFirstNode(nd1);
-			eg->setSecondNode(nd2);
-			eg->setColor(eBaseCol);
-			eg->setOptLen(200);
-			eg->setSize(3);
-			edge.push_back(eg);
-			st.insert({ nd1, nd2 });
-		}
+	static std::string ms(float value) {
+		char buf[32];
+		snprintf(buf, sizeof(buf), "%.2f", value);
+		return buf;
 	}
 
-	void renum() {
-		std::vector <int> nums;
-		for (auto nd : node) {
-			nums.push_back(nd->getNum());
-		}
-		std::sort(nums.begin(), nums.end());
-		nums.resize(std::unique(nums.begin(), nums.end()) - nums.begin());
-		for (auto nd : node) {
-			nd->setString(std::to_string(std::lower_bound(nums.begin(), nums.end(), nd->getNum()) - nums.begin() + 1));
-		}
-		nodeCnt = node.size();
+public:
+	void setFont(const sf::Font& _font) {
+		font = _font;
 	}
 
-	std::string toString() const {
-		std::vector <int> nums;
-		for (auto nd : node) {
-			nums.push_back(nd->getNum());
-		}
-		std::sort(nums.begin(), nums.end());
-		nums.resize(std::unique(nums.begin(), nums.end()) - nums.begin());
-
-		std::string str;
-		str = std::to_string(node.size()) + " " + std::to_string(edge.size()) + "\n";
-		for (auto eg : edge) {
-			str += std::to_string(std::lower_bound(nums.begin(), nums.end(), eg->getFirstNode()->getNum()) - nums.begin() + 1);
-			str += " ";
-			str += std::to_string(std::lower_bound(nums.begin(), nums.end(), eg->getSecondNode()->getNum()) - nums.begin() + 1);
-			str += "\n";
+	void draw(sf::RenderWindow& window, const sf::Vector2f& pos) {
+		const float column = 90, line = 24;
+		float y = pos.y;
+		drawText(window, "ms / frame", pos.x, y);
+		drawText(window, "p50", pos.x + 200, y);
+		drawText(window, "p95", pos.x + 200 + column, y);
+		drawText(window, "p99", pos.x + 200 + column * 2, y);
+		for (const auto& row : profiler.getRows()) {
+			y += line;
+			drawText(window, row.name, pos.x + row.depth * 20, y);
+			drawText(window, ms(row.p50), pos.x + 200, y);
+			drawText(window, ms(row.p95), pos.x + 200 + column, y);
+			drawText(window, ms(row.p99), pos.x + 200 + column * 2, y);
 		}
-
-		return str;
 	}
 };
 
-class SavesMenu {
+// Decides when the window is drawn: only after something changed and at most limit
+// frames per second. A tick that has nothing to draw and nothing running in the
+// background is the last one, the main loop then blocks in waitEvent.
+class FrameScheduler {
 private:
-	std::vector <std::string> paths;
-	int curPos = 0;
-	sf::Font font;
+	sf::Clock clock;
+	sf::Time interval;
+	bool dirty = true;
+	bool running = true;
 
 public:
-	void reload() {
-		paths.clear();
-		std::filesystem::path path(std::filesystem::current_path().string() + "\\saves\\");
-		for (const auto& dir : std::filesystem::directory_iterator(path)) {
-			std::string s = dir.path().filename().string();
-			if (s.substr(s.size() - 4) == ".txt") {
-				paths.push_back(s.substr(0, s.size() - 4));
-			}
-		}
-		sort(paths.begin(), paths.end());
+	FrameScheduler(float limit = 60) {
+		setLimit(limit);
 	}
 
-	SavesMenu() {
-		reload();
+	// 0 - no limit
+	void setLimit(float limit) {
+		interval = limit > 0 ? sf::seconds(1 / limit) : sf::Time::Zero;
 	}
 
-	void movePos(int val) {
-		curPos += val;
-		curPos = std::max(std::min(curPos, (int)paths.size()), 0);
+	// the next tick draws a frame
+	void invalidate() {
+		dirty = true;
 	}
-
-	void setFont(const sf::Font& _font) {
-		font = _font;
+	bool isDirty() const {
+		return dirty;
 	}
 
-	void draw(sf::RenderWindow& window) {
-		sf::Text text;
-		text.setFont(font);
-		std::string str;
-		for (int i = -2; i <= std::min(2, (int)paths.size() - curPos - 1); ++i) {
-			if (i == 0) {
-				str += "> " + paths[curPos];
-			}
-			else if (curPos + i >= 0) {
-				str += paths[curPos + i];
-			}
-			str += '\n';
-		}
-		text.setString(str);
-		text.setFillColor({ 255, 255, 255 });
-		text.setCharacterSize(30);
-		text.setOutlineThickness(2);
-		text.setOutlineColor({ 50, 50, 50 });
-		window.draw(text);
+	// nothing to draw until an event comes
+	bool isIdle() const {
+		return !dirty && !running;
 	}
 
-	void loadGraph(Graph& graph) {
-		if (!paths.empty()) {
-			std::ifstream fin("saves\\" + paths[curPos] + ".txt");
-			fin >> graph;
+	// running - something changes the picture without events (physics, a live trace),
+	// so ticks go on; the rest of the frame interval is slept away
+	void endTick(bool drawn, bool _running) {
+		if (drawn) {
+			dirty = false;
 		}
-	}
-
-	void saveGraph(const Graph& graph, const std::string& saveName) {
-		std::ofstream fout("saves\\" + saveName + ".txt");
-		fout << graph.toString();
+		running = _running;
+		sf::Time left = interval - clock.getElapsedTime();
+		if (left > sf::Time::Zero) {
+			sf::sleep(left);
+		}
+		clock.restart();
 	}
 };
 
@@ -626,6 +302,24 @@ std::string helpString() {
 	s += "Controls:\n";
 	s += "    Help: H\n";
 	s += "    Normalize graph numeration: R\n";
+	s += "    Switch repulsion (all pairs / Barnes-Hut): B\n";
+	s += "    Profiler overlay: F3\n";
+	s += "    Save profile as Chrome trace: F4\n";
+	s += "    Screenshot: F12\n";
+	s += "    Camera:\n";
+	s += "        Zoom: mouse wheel\n";
+	s += "        Pan: drag with right or middle mouse button\n";
+	s += "        Reset: 0\n";
+	s += "    Trace (GraphDrawer <log file>):\n";
+	s += "        Next / previous action group: Right/Left arrows\n";
+	s += "        Jump 1% / 10%: Shift / Ctrl + Right/Left arrows\n";
+	s += "        Start / end: Home/End\n";
+	s += "        Seek: drag the bar at the bottom\n";
+	s += "    Live trace (GraphDrawer <log file> --live [groups per second]):\n";
+	s += "        Pause / resume playing new groups: P\n";
+	s += "    Frame limit (GraphDrawer ... --fps N, 0 - none): 60 by default\n";
+	s += "    Physics threads (GraphDrawer ... --threads N): all cores but one by default\n";
+	s += "    Physics steps per second (GraphDrawer ... --sim-rate N, 0 - as fast as possible, 60 - real time): 0 by default\n";
 	s += "    Exit: Alt + F4\n";
 	s += "    Loading menu:\n";
 	s += "        Open/close: M\n";
@@ -639,6 +333,8 @@ std::string helpString() {
 	s += "	      Move node:\n";
 	s += "	          Activate: 1\n";
 	s += "	          Move nodes with mouse\n";
+	s += "	          Select: drag on empty space, Shift + drag for lasso\n";
+	s += "	          Drag a selected node to move the whole selection\n";
 	s += "	      Add node:\n";
 	s += "	          Activate: 2\n";
 	s += "	          Add node by mouse click\n";
@@ -653,26 +349,82 @@ std::string helpString() {
 	return s;
 }
 
-int main() {
+int main(int argc, char* argv[]) {
 	sf::ContextSettings settings;
 	settings.antialiasingLevel = 8;
 	sf::RenderWindow window(sf::VideoMode::getDesktopMode(), "window", sf::Style::Fullscreen, settings);
-	boardSize = sf::Vector2f(window.getSize());
-	boardOffset = boardSize / 10.f;
+	sf::Vector2f boardSize(window.getSize());
 
 	sf::Font font;
 	font.loadFromFile("font/arialmt.ttf");
 
+	// phases of the last frames are always kept, F4 saves them for chrome://tracing
+	profiler.setEnabled(true);
+	ProfileOverlay profileOverlay;
+	profileOverlay.setFont(font);
+	bool profileShown = false;
+	std::string profileSaved;
+
 	Graph graph;
 	graph.setFont(font);
-	//std::ifstream fin("GraphLog.txt");
-	//fin >> graph;
+	graph.setBoard(boardSize, boardSize / 10.f);
+	// GraphDrawer [<log file> [--live [groups per second]]] [--fps N] [--threads N] [--sim-rate N]
+	std::string logPath;
+	bool live = false;
+	float liveRate = 30;
+	float liveBudget = 0;
+	bool livePaused = false;
+	float fps = 60;
+	// physics threads, one core is left to drawing
+	int threads = std::max((int)std::thread::hardware_concurrency() - 1, 1);
+	float simRate = 0;
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--live") {
+			live = true;
+			if (i + 1 < argc && std::isdigit((unsigned char)argv[i + 1][0])) {
+				liveRate = std::stof(argv[++i]);
+			}
+		}
+		else if (arg == "--fps" && i + 1 < argc) {
+			fps = std::stof(argv[++i]);
+		}
+		else if (arg == "--threads" && i + 1 < argc) {
+			threads = std::stoi(argv[++i]);
+		}
+		else if (arg == "--sim-rate" && i + 1 < argc) {
+			simRate = std::stof(argv[++i]);
+		}
+		else {
+			logPath = arg;
+		}
+	}
+	graph.setThreads(threads);
+	// layout converges as fast as the physics threads allow while frames are drawn at their own pace
+	graph.setSimulationRate(simRate);
+	graph.setSimulationThread(true);
+	if (live) {
+		graph.openLive(logPath);
+	}
+	else if (!logPath.empty()) {
+		graph.openTrace(logPath);
+	}
 
-	Node* toMove = nullptr;
+	// frames are drawn only when something changed, at most fps a second
+	FrameScheduler scheduler(fps);
+
+	int toMove = -1;
 	sf::Vector2f toMovePos0;
 	sf::Vector2f wasMousePos;
 
-	Node* subEdgeStart = nullptr;
+	int subEdgeStart = -1;
+
+	// nodes picked by a rectangle or a lasso in move mode, dragging one of them moves all
+	std::vector <int> selection;
+	std::vector <sf::Vector2f> selectionPos0;
+	bool selecting = false;
+	bool lassoMode = false;
+	std::vector <sf::Vector2f> lasso;
 
 	if (!std::filesystem::exists(std::filesystem::current_path().string() + "\\saves\\")) {
 		std::filesystem::create_directory(std::filesystem::current_path().string() + "\\saves\\");
@@ -691,51 +443,137 @@ int main() {
 	bool inpActive = false;
 
 	bool help = false;
+
+	// F12 copies the window out of the GPU and leaves the encoding to the saver threads
+	ImageSaver screenshots(2);
+	sf::Texture screenTexture;
+	int screenshotCount = 0;
+
+	Timeline timeline;
+	timeline.setFont(font);
+	timeline.setWindowSize(boardSize);
+	bool scrubbing = false;
+
+	// the graph is drawn through the camera, the interface in window coordinates
+	sf::View camera = window.getDefaultView();
+	float zoom = 1; // board units in a pixel
+	bool panning = false;
+	sf::Vector2i panLast;
+	auto toBoard = [&](int x, int y) {
+		return window.mapPixelToCoords({ x, y }, camera);
+	};
 	
 
 	sf::Clock clock;
+	int shownScreenshots = 0;
 	while (window.isOpen()) {
+		sf::Event event;
+		bool waited = scheduler.isIdle() && window.waitEvent(event);
+		if (waited) {
+			// the time spent waiting is not physics time
+			clock.restart();
+		}
 		float time = clock.restart().asSeconds();
+		ProfileScope frameScope("frame");
 
-		sf::Event event;
-		while (window.pollEvent(event)) {
+		ProfileScope eventScope("events");
+		while (waited || window.pollEvent(event)) {
+			waited = false;
+			scheduler.invalidate();
 			if (event.type == sf::Event::Closed) {
 				window.close();
 			}
 			
+			if (event.type == sf::Event::MouseWheelScrolled && !menuActive) {
+				// the point under the cursor stays in place
+				float k = std::pow(0.85f, event.mouseWheelScroll.delta);
+				k = std::min(std::max(zoom * k, 0.02f), 50.f) / zoom;
+				sf::Vector2f before = toBoard(event.mouseWheelScroll.x, event.mouseWheelScroll.y);
+				camera.zoom(k);
+				zoom *= k;
+				camera.move(before - toBoard(event.mouseWheelScroll.x, event.mouseWheelScroll.y));
+			}
+			if (event.type == sf::Event::MouseButtonPressed && (event.mouseButton.button == sf::Mouse::Right || event.mouseButton.button == sf::Mouse::Middle)) {
+				panning = true;
+				panLast = { event.mouseButton.x, event.mouseButton.y };
+			}
+			if (event.type == sf::Event::MouseMoved && panning) {
+				camera.move(toBoard(panLast.x, panLast.y) - toBoard(event.mouseMove.x, event.mouseMove.y));
+				panLast = { event.mouseMove.x, event.mouseMove.y };
+			}
+			if (event.type == sf::Event::MouseButtonReleased && (event.mouseButton.button == sf::Mouse::Right || event.mouseButton.button == sf::Mouse::Middle)) {
+				panning = false;
+			}
+
 			if (event.type == sf::Event::MouseButtonPressed) {
-				if (event.mouseButton.button == sf::Mouse::Left) {
+				sf::Vector2f point((float)event.mouseButton.x, (float)event.mouseButton.y);
+				sf::Vector2f boardPoint = toBoard(event.mouseButton.x, event.mouseButton.y);
+				if (event.mouseButton.button == sf::Mouse::Left && graph.getActionCount() > 0 && timeline.isContains(point)) {
+					scrubbing = true;
+					graph.seekAction(timeline.actionAt(point.x, graph.getActionCount()));
+				}
+				else if (event.mouseButton.button == sf::Mouse::Left) {
 					if (actionType == 1) {
-						toMove = graph.getNodeAtPoint({ (float)event.mouseButton.x, (float)event.mouseButton.y });
-						if (toMove != nullptr) {
-							toMovePos0 = toMove->getPos();
-							wasMousePos = { (float)event.mouseButton.x, (float)event.mouseButton.y };
+						toMove = graph.getNodeAtPointInd(boardPoint);
+						if (toMove != -1) {
+							toMovePos0 = graph.getNodePos(toMove);
+							wasMousePos = boardPoint;
+							if (!std::binary_search(selection.begin(), selection.end(), toMove)) {
+								selection.clear();
+							}
+							selectionPos0.clear();
+							for (int nd : selection) {
+								selectionPos0.push_back(graph.getNodePos(nd));
+							}
+						}
+						else {
+							selection.clear();
+							selecting = true;
+							lassoMode = sf::Keyboard::isKeyPressed(sf::Keyboard::LShift) || sf::Keyboard::isKeyPressed(sf::Keyboard::RShift);
+							lasso = { boardPoint };
 						}
 					}
 					if (actionType == 2) {
-						graph.addNode({ (float)event.mouseButton.x, (float)event.mouseButton.y });
+						graph.addNode(boardPoint);
 					}
 					if (actionType == 3) {
-						int ind = graph.getNodeAtPointInd(sf::Vector2f({ (float)event.mouseButton.x, (float)event.mouseButton.y }));
+						int ind = graph.getNodeAtPointInd(boardPoint);
 						graph.deleteNode(ind);
+						selection.clear();
 					}
 					if (actionType == 4) {
-						subEdgeStart = graph.getNodeAtPoint({ (float)event.mouseButton.x, (float)event.mouseButton.y });
+						subEdgeStart = graph.getNodeAtPointInd(boardPoint);
 					}
 				}
 			}
+			if (event.type == sf::Event::MouseMoved && scrubbing) {
+				graph.seekAction(timeline.actionAt((float)event.mouseMove.x, graph.getActionCount()));
+			}
+			if (event.type == sf::Event::MouseMoved && selecting && lassoMode) {
+				lasso.push_back(toBoard(event.mouseMove.x, event.mouseMove.y));
+			}
 			if (event.type == sf::Event::MouseButtonReleased) {
 				if (event.mouseButton.button == sf::Mouse::Left) {
-					if (toMove != nullptr) {
-						toMove->clearVelocity();
-						toMove = nullptr;
+					scrubbing = false;
+					if (selecting) {
+						sf::Vector2f point = toBoard(event.mouseButton.x, event.mouseButton.y);
+						selection = lassoMode ? graph.getNodesInPolygon(lasso) : graph.getNodesInRect(sf::FloatRect(lasso[0], point - lasso[0]));
+						selecting = false;
+						lasso.clear();
+					}
+					if (toMove != -1) {
+						graph.clearNodeVelocity(toMove);
+						for (int nd : selection) {
+							graph.clearNodeVelocity(nd);
+						}
+						toMove = -1;
 					}
-					if (subEdgeStart != nullptr) {
-						Node* nd = graph.getNodeAtPoint({ (float)event.mouseButton.x, (float)event.mouseButton.y });
-						if (nd != nullptr) {
+					if (subEdgeStart != -1) {
+						int nd = graph.getNodeAtPointInd(toBoard(event.mouseButton.x, event.mouseButton.y));
+						if (nd != -1) {
 							graph.swapEdge(subEdgeStart, nd);
 						}
-						subEdgeStart = nullptr;
+						subEdgeStart = -1;
 					}
 				}
 			}
@@ -754,30 +592,51 @@ int main() {
 			}
 
 			if (event.type == sf::Event::KeyPressed) {
-				/*if (event.key.code == sf::Keyboard::Right) {
-					graph.nextAction(fin);
+				if ((event.key.code == sf::Keyboard::Right || event.key.code == sf::Keyboard::Left) && !inpActive && !menuActive) {
+					int dir = event.key.code == sf::Keyboard::Right ? 1 : -1;
+					if (event.key.control || event.key.shift) {
+						int step = std::max(graph.getActionCount() / (event.key.control ? 10 : 100), 1);
+						graph.seekAction(graph.getCurAction() + dir * step);
+					}
+					else if (dir == 1) {
+						graph.nextAction();
+					}
+					else {
+						graph.prevAction();
+					}
+				}
+				if (event.key.code == sf::Keyboard::Home && !inpActive) {
+					graph.seekAction(0);
+				}
+				if (event.key.code == sf::Keyboard::End && !inpActive) {
+					graph.seekAction(graph.getActionCount());
+				}
+				if (event.key.code == sf::Keyboard::Num0 && !inpActive) {
+					camera = window.getDefaultView();
+					zoom = 1;
 				}
-				if (event.key.code == sf::Keyboard::Left) {
-					graph.prevAction();
-				}*/
 				if (event.key.code == sf::Keyboard::Num1 && !inpActive) {
 					actionType = 1;
 				}
 				if (event.key.code == sf::Keyboard::Num2 && !inpActive) {
 					actionType = 2;
+					selection.clear();
 				}
 				if (event.key.code == sf::Keyboard::Num3 && !inpActive) {
 					actionType = 3;
+					selection.clear();
 				}
 				if (event.key.code == sf::Keyboard::Num4 && !inpActive) {
 					actionType = 4;
+					selection.clear();
 				}
 				if (event.key.code == sf::Keyboard::F12 && !inpActive) {
-					sf::Texture tex;
-					tex.create(window.getSize().x, window.getSize().y);
-					tex.update(window);
-					sf::Image im = tex.copyToImage();
-					im.saveToFile("iovsivosnv.png");
+					if (screenTexture.getSize() != window.getSize()) {
+						screenTexture.create(window.getSize().x, window.getSize().y);
+					}
+					screenTexture.update(window);
+					std::string path = "screenshot_" + std::to_string((long long)std::time(nullptr)) + "_" + std::to_string(screenshotCount++) + ".png";
+					screenshots.save(screenTexture.copyToImage(), path);
 				}
 				if (event.key.code == sf::Keyboard::R && !inpActive) {
 					graph.renum();
@@ -806,6 +665,7 @@ int main() {
 					}
 					else if (menuActive) {
 						menu.loadGraph(graph);
+						selection.clear();
 					}
 				}
 				if (event.key.code == sf::Keyboard::Escape) {
@@ -824,27 +684,117 @@ int main() {
 				if (event.key.code == sf::Keyboard::H && !inpActive) {
 					help ^= 1;
 				}
+				if (event.key.code == sf::Keyboard::F3 && !inpActive) {
+					profileShown ^= 1;
+				}
+				if (event.key.code == sf::Keyboard::F4 && !inpActive) {
+					std::string path = "profile_" + std::to_string((long long)std::time(nullptr)) + ".json";
+					profileSaved = profiler.save(path) ? path : "can't save " + path;
+				}
+				if (event.key.code == sf::Keyboard::P && !inpActive) {
+					livePaused ^= 1;
+				}
+				if (event.key.code == sf::Keyboard::B && !inpActive) {
+					if (graph.getRepulsion() == Layout::Repulsion::BarnesHut) {
+						graph.setRepulsion(Layout::Repulsion::AllPairs);
+					}
+					else {
+						graph.setRepulsion(Layout::Repulsion::BarnesHut);
+					}
+				}
 			}
 		}
 
+		eventScope.end();
+
+		ProfileScope physicsScope("physics");
+		// an edit or a loaded save ends the live trace
+		if (graph.isLive()) {
+			if (graph.pollLive() > 0) {
+				scheduler.invalidate();
+			}
+			// groups that have arrived are played at liveRate per second, 0 - all at once
+			liveBudget += liveRate * time;
+			while (!livePaused && graph.getCurAction() < graph.getActionCount() && (liveRate <= 0 || liveBudget >= 1)) {
+				graph.nextAction();
+				liveBudget -= 1;
+				scheduler.invalidate();
+			}
+			liveBudget = std::min(std::max(liveBudget, 0.f), 1.f);
+		}
+
+		// the step that puts the layout to sleep still moves it
+		if (!graph.isSleeping()) {
+			scheduler.invalidate();
+		}
 		graph.update(time);
 
-		if (toMove != nullptr) {
-			toMove->setPos(toMovePos0 - wasMousePos + sf::Vector2f(sf::Mouse::getPosition()));
-			toMove->clearVelocity();
+		sf::Vector2i mousePixel = sf::Mouse::getPosition(window);
+		sf::Vector2f mouse = toBoard(mousePixel.x, mousePixel.y);
+		if (toMove != -1) {
+			sf::Vector2f shift = mouse - wasMousePos;
+			graph.setNodePos(toMove, toMovePos0 + shift);
+			graph.clearNodeVelocity(toMove);
+			for (int i = 0; i < selection.size(); ++i) {
+				graph.setNodePos(selection[i], selectionPos0[i] + shift);
+				graph.clearNodeVelocity(selection[i]);
+			}
+		}
+
+		physicsScope.end();
+
+		if (screenshots.getPending() != shownScreenshots) {
+			shownScreenshots = screenshots.getPending();
+			scheduler.invalidate();
+		}
+		if (menuActive && menu.hasUpdate()) {
+			scheduler.invalidate();
+		}
+		// these change the picture without events, so they are polled every tick
+		bool running = !graph.isSleeping() || (graph.isLive() && !livePaused) || shownScreenshots > 0 || (menuActive && menu.isScanning());
+		if (!scheduler.isDirty()) {
+			frameScope.end();
+			scheduler.endTick(false, running);
+			continue;
 		}
 
+		ProfileScope drawScope("draw");
 		window.clear(sf::Color(0, 0, 0, 0));
-		if (subEdgeStart != nullptr) {
+		window.setView(camera);
+		if (subEdgeStart != -1) {
 			Edge edge;
 			edge.setColor(eBaseCol);
-			edge.setFirstNode(subEdgeStart);
-			Node nd;
-			nd.setPos(sf::Vector2f(sf::Mouse::getPosition()));
-			edge.setSecondNode(&nd);
-			window.draw(edge);
+			edge.draw(window, sf::RenderStates::Default, graph.getNodePos(subEdgeStart), mouse);
 		}
+		ProfileScope graphScope("graph");
 		window.draw(graph);
+		graphScope.end();
+
+		if (!selection.empty()) {
+			sf::VertexArray marks(sf::Quads, selection.size() * 4);
+			for (int i = 0; i < selection.size(); ++i) {
+				Node::setQuad(&marks[i * 4], graph.getNodePos(selection[i]), 4 * zoom, sf::Color(255, 220, 0));
+			}
+			window.draw(marks);
+		}
+		if (selecting && lassoMode) {
+			sf::VertexArray line(sf::LineStrip);
+			for (const auto& p : lasso) {
+				line.append(sf::Vertex(p, sf::Color(255, 220, 0)));
+			}
+			window.draw(line);
+		}
+		else if (selecting) {
+			sf::RectangleShape rect(mouse - lasso[0]);
+			rect.setPosition(lasso[0]);
+			rect.setFillColor(sf::Color(255, 220, 0, 40));
+			rect.setOutlineColor(sf::Color(255, 220, 0));
+			rect.setOutlineThickness(zoom);
+			window.draw(rect);
+		}
+		window.setView(window.getDefaultView());
+
+		ProfileScope uiScope("interface");
 
 		if (menuActive) {
 			menu.draw(window);
@@ -852,18 +802,36 @@ int main() {
 		else {
 			sf::Text text;
 			text.setFont(font);
+			std::string str;
 			if (actionType == 1) {
-				text.setString("cur: move node");
+				str = "cur: move node";
 			}
 			if (actionType == 2) {
-				text.setString("cur: add node");
+				str = "cur: add node";
 			}
 			if (actionType == 3) {
-				text.setString("cur: delete node");
+				str = "cur: delete node";
 			}
 			if (actionType == 4) {
-				text.setString("cur: switch edge");
+				str = "cur: switch edge";
+			}
+			str += "\ndraw calls: " + std::to_string(graph.getDrawCalls());
+			if (zoom != 1) {
+				str += "\nzoom: " + std::to_string((int)std::round(100 / zoom)) + "%";
 			}
+			if (graph.isSleeping()) {
+				str += "\nphysics: sleeping";
+			}
+			if (graph.isLive()) {
+				str += livePaused ? "\nlive: paused" : "\nlive";
+			}
+			if (screenshots.getPending() > 0) {
+				str += "\nsaving screenshots: " + std::to_string(screenshots.getPending());
+			}
+			if (!profileSaved.empty()) {
+				str += "\nprofile: " + profileSaved;
+			}
+			text.setString(str);
 			text.setFillColor({ 255, 255, 255 });
 			text.setCharacterSize(30);
 			text.setOutlineThickness(2);
@@ -888,6 +856,8 @@ int main() {
 			window.draw(text);
 		}
 
+		timeline.draw(window, graph.getCurAction(), graph.getActionCount());
+
 		if (inpActive) {
 			sf::Text text;
 			text.setFont(font);
@@ -900,9 +870,19 @@ int main() {
 			window.draw(text);
 		}
 
+		if (profileShown) {
+			profileOverlay.draw(window, { 10, window.getSize().y * 0.4f });
+		}
+		uiScope.end();
+		drawScope.end();
+
+		ProfileScope displayScope("display");
 		window.display();
+		displayScope.end();
+		frameScope.end();
+		profiler.endFrame();
+		scheduler.endTick(true, running);
 	}
 
-	//fin.close();
 	return 0;
 }
@@ -2,17 +2,66 @@
 #include <vector>
 #include <map>
 #include <iostream>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+#include "GraphTrace.h"
 
 namespace gdraw {
-	// тут надо поставить путь до папки в которой отрисовщик лежит \\GraphLog.txt
-	std::ofstream fout("C:\\Users\\Galina\\Desktop\\прг\\что-то\\GraphDrawer\\ivan\\GraphLog.txt");
+	// тут надо поставить путь до папки в которой отрисовщик лежит \\GraphLog.txt,
+	// или передать путь в init. Файл открывает init, само подключение заголовка ничего не создаёт
+	std::string path = "C:\\Users\\Galina\\Desktop\\прг\\что-то\\GraphDrawer\\ivan\\GraphLog.txt";
+	std::ofstream fout;
+
+	// Text пишет "nc 17 4294967295" построчно, Binary пишет формат из GraphTrace.h,
+	// он в разы меньше и отрисовщик читает его без парсинга строк
+	enum class Format {
+		Text,
+		Binary
+	};
+	Format format = Format::Text;
 
-	int actCnt = 1;
+	int actCnt = 0; // сколько действий осталось в блоке, 0 и меньше - блок не начат
+	// 0 - файл сбрасывается как придётся, иначе законченные блоки сбрасываются в файл раз
+	// в flushInterval секунд (без async - на ближайшем действии после этого срока).
+	// Недописанный блок в файл не идёт никогда, так в логе те же группы, что и без flushInterval
+	double flushInterval = 0;
+	std::chrono::steady_clock::time_point lastWrite; // без async: когда fout сбрасывался
+	bool unflushed = false; // без async: в fout есть законченные блоки, которых ещё нет в файле
 	std::vector <std::string> buff;
+	std::string bin;
+	int binCnt = 0;
 	std::map <std::pair <int, int>, int> edgeNum;
 
+	// вызывать до init
+	void setFormat(Format _format) {
+		format = _format;
+	}
+
 	void init(int nodeCnt, const std::vector <std::pair <int, int>>& edge) {
+		fout.close();
 		fout.clear();
+		fout.open(path, format == Format::Binary ? std::ios::out | std::ios::binary : std::ios::out);
+		if (!fout) {
+			std::cerr << "|ERROR| gdraw: can't open " << path << '\n';
+		}
+
+		if (format == Format::Binary) {
+			std::string head(gtrace::magic, 4);
+			head += (char)gtrace::version;
+			gtrace::putVarint(head, nodeCnt);
+			gtrace::putVarint(head, edge.size());
+			for (int i = 0; i < edge.size(); ++i) {
+				auto [u, v] = edge[i];
+				edgeNum[{u, v}] = i;
+				edgeNum[{v, u}] = i;
+				gtrace::putVarint(head, u);
+				gtrace::putVarint(head, v);
+			}
+			fout.write(head.data(), head.size());
+			return;
+		}
 
 		fout << nodeCnt << ' ' << edge.size() << '\n';
 		for (int i = 0; i < edge.size(); ++i) {
@@ -33,8 +82,46 @@ namespace gdraw {
 		}
 		init(g.size(), edge);
 	}
+	void init(const std::string& _path, int nodeCnt, const std::vector <std::pair <int, int>>& edge) {
+		path = _path;
+		init(nodeCnt, edge);
+	}
+	void init(const std::string& _path, const std::vector <std::vector <int>>& g) {
+		path = _path;
+		init(g);
+	}
+
+	const char* opName(gtrace::Op op) {
+		return op == gtrace::NodeColor ? "nc" : "ec";
+	}
+
+	void record(gtrace::Op op, int ind, unsigned int col) {
+		if (format == Format::Binary) {
+			gtrace::Record rec;
+			rec.op = op;
+			rec.a = ind;
+			rec.b = col;
+			gtrace::putRecord(bin, rec);
+			++binCnt;
+		}
+		else {
+			buff.push_back(opName(op) + (' ' + std::to_string(ind + 1)) + ' ' + std::to_string(col));
+		}
+	}
+
+	void writeGroup() {
+		if (format == Format::Binary) {
+			if (binCnt > 0) {
+				std::string head;
+				gtrace::putVarint(head, binCnt);
+				fout.write(head.data(), head.size());
+				fout.write(bin.data(), bin.size());
+				bin.clear();
+				binCnt = 0;
+			}
+			return;
+		}
 
-	void flush() {
 		if (!buff.empty()) {
 			fout << buff.size() << '\n';
 			for (const auto& s : buff) {
@@ -44,6 +131,126 @@ namespace gdraw {
 		}
 	}
 
+	// Async: действие это 12 байт в заранее выделенном кольцевом буфере, без аллокаций,
+	// а форматирует и пишет в файл отдельный поток
+	struct Event {
+		unsigned char op; // 0 - конец блока
+		int ind;
+		unsigned int col;
+	};
+	std::vector <Event> ring;
+	size_t ringMask = 0;
+	std::atomic <size_t> ringHead(0); // сколько прочитал поток записи
+	std::atomic <size_t> ringTail(0); // сколько записали
+	size_t cachedHead = 0;
+	std::atomic <bool> asyncStop(false);
+	std::thread writer;
+	bool async = false;
+
+	void writerLoop() {
+		auto lastWrite = std::chrono::steady_clock::now();
+		bool written = false; // есть законченные блоки, которые ещё не сброшены в файл
+		while (true) {
+			size_t head = ringHead.load(std::memory_order_relaxed);
+			size_t tail = ringTail.load(std::memory_order_acquire);
+			for (; head != tail; ++head) {
+				const Event& ev = ring[head & ringMask];
+				if (ev.op == 0) {
+					writeGroup();
+					written = true;
+				}
+				else {
+					record((gtrace::Op)ev.op, ev.ind, ev.col);
+				}
+			}
+			ringHead.store(head, std::memory_order_release);
+			// по таймеру сбрасываются только законченные блоки, они уже лежат в fout
+			if (flushInterval > 0 && written &&
+				std::chrono::duration <double>(std::chrono::steady_clock::now() - lastWrite).count() >= flushInterval) {
+				fout.flush();
+				written = false;
+				lastWrite = std::chrono::steady_clock::now();
+			}
+			// stop читается раньше хвоста: после stopAsync хвост уже последний
+			bool stop = asyncStop.load();
+			if (head == ringTail.load(std::memory_order_acquire)) {
+				if (stop) {
+					break;
+				}
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		}
+		writeGroup();
+		fout.flush();
+	}
+
+	void pushEvent(unsigned char op, int ind, unsigned int col) {
+		size_t tail = ringTail.load(std::memory_order_relaxed);
+		while (tail - cachedHead > ringMask) {
+			std::this_thread::yield();
+			cachedHead = ringHead.load(std::memory_order_acquire);
+		}
+		ring[tail & ringMask] = { op, ind, col };
+		ringTail.store(tail + 1, std::memory_order_release);
+	}
+
+	// вызывать после init, capacity округляется вверх до степени двойки
+	void startAsync(int capacity = 1 << 20) {
+		if (async) {
+			return;
+		}
+		size_t sz = 1;
+		while (sz < capacity) {
+			sz <<= 1;
+		}
+		ring.assign(sz, Event());
+		ringMask = sz - 1;
+		ringHead = ringTail = cachedHead = 0;
+		asyncStop = false;
+		async = true;
+		writer = std::thread(writerLoop);
+	}
+	// дописывает всё что осталось в буфере
+	void stopAsync() {
+		if (!async) {
+			return;
+		}
+		asyncStop = true;
+		writer.join();
+		async = false;
+	}
+	struct AsyncGuard {
+		~AsyncGuard() {
+			stopAsync();
+		}
+	} asyncGuard;
+
+	void flush() {
+		if (async) {
+			pushEvent(0, 0, 0);
+		}
+		else {
+			writeGroup();
+			unflushed = true;
+		}
+	}
+
+	void flushByTimer() {
+		if (flushInterval > 0 && unflushed &&
+			std::chrono::duration <double>(std::chrono::steady_clock::now() - lastWrite).count() >= flushInterval) {
+			fout.flush();
+			unflushed = false;
+			lastWrite = std::chrono::steady_clock::now();
+		}
+	}
+
+	// для GraphDrawer <лог> --live: законченные блоки раз в seconds уходят в файл,
+	// так алгоритм видно пока он работает. Вызывать до startAsync
+	void setFlushInterval(double seconds) {
+		flushInterval = seconds;
+		lastWrite = std::chrono::steady_clock::now();
+	}
+
 	void setBlockSize(int sz) {
 		if (actCnt != 0) {
 			std::cerr << "|ERROR| gdraw: prev block not finished\n";
@@ -53,34 +260,48 @@ namespace gdraw {
 		}
 	}
 
-	void changeNodeColor(int node, unsigned int r, unsigned int g, unsigned int b) {
-		buff.push_back("nc " + std::to_string(node + 1) + ' ' + std::to_string((r << 24) | (g << 16) | (b << 8) | 255));
+	void pushAction(gtrace::Op op, int ind, unsigned int col) {
+		if (async) {
+			pushEvent(op, ind, col);
+		}
+		else {
+			record(op, ind, col);
+		}
 		--actCnt;
 		if (actCnt <= 0) {
 			gdraw::flush();
 		}
+		if (!async) {
+			flushByTimer();
+		}
+	}
+
+	// дописывает недописанный блок и закрывает лог, дальше можно снова init с другим графом
+	// или в другой файл; формат, путь и flushInterval остаются
+	void reset() {
+		stopAsync();
+		writeGroup();
+		fout.close();
+		buff.clear();
+		bin.clear();
+		binCnt = 0;
+		edgeNum.clear();
+		actCnt = 0;
+		unflushed = false;
+	}
+
+	void changeNodeColor(int node, unsigned int r, unsigned int g, unsigned int b) {
+		pushAction(gtrace::NodeColor, node, (r << 24) | (g << 16) | (b << 8) | 255);
 	}
 	void clearNodeColor(int node) {
-		buff.push_back("nc " + std::to_string(node + 1) + ' ' + std::to_string((255 << 24) | (255 << 16) | (255 << 8) | 255));
-		--actCnt;
-		if (actCnt <= 0) {
-			gdraw::flush();
-		}
+		changeNodeColor(node, 255, 255, 255);
 	}
 
 	void changeEdgeColor(int edge, unsigned int r, unsigned int g, unsigned int b) {
-		buff.push_back("ec " + std::to_string(edge + 1) + ' ' + std::to_string((r << 24) | (g << 16) | (b << 8) | 255));
-		--actCnt;
-		if (actCnt <= 0) {
-			gdraw::flush();
-		}
+		pushAction(gtrace::EdgeColor, edge, (r << 24) | (g << 16) | (b << 8) | 255);
 	}
 	void clearEdgeColor(int edge) {
-		buff.push_back("ec " + std::to_string(edge + 1) + ' ' + std::to_string((255 << 24) | (255 << 16) | (255 << 8) | 255));
-		--actCnt;
-		if (actCnt <= 0) {
-			gdraw::flush();
-		}
+		changeEdgeColor(edge, 255, 255, 255);
 	}
 	void changeEdgeColor(int node1, int node2, unsigned int r, unsigned int g, unsigned int b) {
 		changeEdgeColor(edgeNum[{node1, node2}], r, g, b);
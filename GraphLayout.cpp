@@ -0,0 +1,218 @@
+#define SFML_STATIC
+
+#include <SFML/Graphics.hpp>
+#include <fstream>
+#include <string>
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <cstdio>
+#include <filesystem>
+
+#include "Graph.h"
+#include "ImageSaver.h"
+
+// Lays out a graph without a window:
+//     GraphLayout GraphLog.txt --steps 2000 -o positions.txt --png layout.png
+// or plays a whole trace into numbered frames for an animation:
+//     GraphLayout GraphLog.txt --frames frames --frame-steps 4
+void usage() {
+	std::cerr << "usage: GraphLayout <graph file> [options]\n";
+	std::cerr << "    the graph is a binary save (.graph) or \"n m\" and m edges as text\n";
+	std::cerr << "    --steps N          steps to run (default 1000)\n";
+	std::cerr << "    --until EPS        stop earlier when no node moves more than EPS per step\n";
+	std::cerr << "    --dt T             time of one step in seconds (default 0.016)\n";
+	std::cerr << "    --bh THETA         Barnes-Hut repulsion instead of all pairs\n";
+	std::cerr << "    --board W H        board size (default 1920 1080)\n";
+	std::cerr << "    --threads N        physics threads (default: all cores), same N gives the same layout\n";
+	std::cerr << "    --seed S           seed for initial positions\n";
+	std::cerr << "    --random           start big graphs from random points, not from the multilevel placement\n";
+	std::cerr << "    -o FILE            write node positions to FILE instead of stdout\n";
+	std::cerr << "    --png FILE         render the layout to FILE through an offscreen target\n";
+	std::cerr << "    --font FILE        font for node labels (default font/arialmt.ttf)\n";
+	std::cerr << "    --frames DIR       play the trace and write DIR/frame_000000.png and on, after --steps steps\n";
+	std::cerr << "    --every K          action groups per frame (default 1)\n";
+	std::cerr << "    --frame-steps N    physics steps between frames (default 1)\n";
+}
+
+int main(int argc, char* argv[]) {
+	if (argc < 2) {
+		usage();
+		return 1;
+	}
+
+	std::string input = argv[1];
+	int steps = 1000;
+	float until = -1;
+	float dt = 0.016f;
+	float theta = -1;
+	int threads = std::thread::hardware_concurrency();
+	sf::Vector2f boardSize(1920, 1080);
+	std::string output;
+	std::string png;
+	std::string fontPath = "font/arialmt.ttf";
+	bool multilevel = true;
+	std::string frames;
+	int every = 1;
+	int frameSteps = 1;
+
+	for (int i = 2; i < argc; ++i) {
+		std::string arg = argv[i];
+		bool hasNext = i + 1 < argc;
+		if (arg == "--steps" && hasNext) {
+			steps = std::stoi(argv[++i]);
+		}
+		else if (arg == "--until" && hasNext) {
+			until = std::stof(argv[++i]);
+		}
+		else if (arg == "--dt" && hasNext) {
+			dt = std::stof(argv[++i]);
+		}
+		else if (arg == "--bh" && hasNext) {
+			theta = std::stof(argv[++i]);
+		}
+		else if (arg == "--board" && i + 2 < argc) {
+			boardSize.x = std::stof(argv[++i]);
+			boardSize.y = std::stof(argv[++i]);
+		}
+		else if (arg == "--threads" && hasNext) {
+			threads = std::stoi(argv[++i]);
+		}
+		else if (arg == "--seed" && hasNext) {
+			rnd.seed(std::stoul(argv[++i]));
+		}
+		else if (arg == "--random") {
+			multilevel = false;
+		}
+		else if (arg == "-o" && hasNext) {
+			output = argv[++i];
+		}
+		else if (arg == "--png" && hasNext) {
+			png = argv[++i];
+		}
+		else if (arg == "--font" && hasNext) {
+			fontPath = argv[++i];
+		}
+		else if (arg == "--frames" && hasNext) {
+			frames = argv[++i];
+		}
+		else if (arg == "--every" && hasNext) {
+			every = std::max(std::stoi(argv[++i]), 1);
+		}
+		else if (arg == "--frame-steps" && hasNext) {
+			frameSteps = std::stoi(argv[++i]);
+		}
+		else {
+			usage();
+			return 1;
+		}
+	}
+
+	std::ifstream fin(input);
+	if (!fin) {
+		std::cerr << "|ERROR| GraphLayout: can't open " << input << '\n';
+		return 1;
+	}
+
+	// the font is rasterized on the first draw, without --png and --frames nothing needs a GL context
+	Graph graph;
+	sf::Font font;
+	if (!png.empty() || !frames.empty()) {
+		font.loadFromFile(fontPath);
+		graph.setFont(font);
+	}
+	graph.setBoard(boardSize, boardSize / 10.f);
+	graph.setThreads(threads);
+	graph.setMultilevel(multilevel);
+	if (theta >= 0) {
+		graph.setRepulsion(Layout::Repulsion::BarnesHut);
+		graph.setTheta(theta);
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	if (frames.empty()) {
+		// a save keeps its positions, a pipe can not be mapped and is read as a stream
+		if (!graph.loadBinary(input) && !graph.loadText(input) && !(fin >> graph)) {
+			std::cerr << "|ERROR| GraphLayout: " << input << " is neither a save nor a text graph\n";
+			return 1;
+		}
+	}
+	else if (!graph.openTrace(input)) {
+		std::cerr << "|ERROR| GraphLayout: can't open trace " << input << '\n';
+		return 1;
+	}
+	auto loaded = std::chrono::steady_clock::now();
+
+	int done = 0;
+	while (done < steps) {
+		graph.step(dt);
+		++done;
+		if (until >= 0 && graph.getLayout().getMaxShift() < until) {
+			break;
+		}
+	}
+	auto finished = std::chrono::steady_clock::now();
+
+	std::cerr << "nodes: " << graph.getLayout().size() << ", edges: " << graph.getLayout().springCount() << '\n';
+	std::cerr << "load: " << std::chrono::duration <double>(loaded - start).count() << " s\n";
+	std::cerr << "threads: " << graph.getLayout().getThreads() << '\n';
+	std::cerr << "steps: " << done << ", " << std::chrono::duration <double>(finished - loaded).count() << " s\n";
+	std::cerr << "max shift: " << graph.getLayout().getMaxShift() << '\n';
+
+	sf::RenderTexture target;
+	if (!png.empty() || !frames.empty()) {
+		sf::ContextSettings settings;
+		settings.antialiasingLevel = 8;
+		if (!target.create(boardSize.x, boardSize.y, settings)) {
+			std::cerr << "|ERROR| GraphLayout: can't create offscreen target\n";
+			return 1;
+		}
+	}
+
+	if (!frames.empty()) {
+		// the render thread only draws and reads back, frames are encoded on all the other cores
+		std::filesystem::create_directories(frames);
+		ImageSaver saver(std::max((int)std::thread::hardware_concurrency() - 1, 1));
+		int frame = 0;
+		char name[32];
+		while (true) {
+			target.clear(sf::Color(0, 0, 0, 255));
+			target.draw(graph);
+			target.display();
+			snprintf(name, sizeof(name), "/frame_%06d.png", frame++);
+			saver.save(target.getTexture().copyToImage(), frames + name);
+
+			if (graph.getCurAction() == graph.getActionCount()) {
+				break;
+			}
+			for (int i = 0; i < every && graph.nextAction(); ++i) {}
+			for (int i = 0; i < frameSteps; ++i) {
+				graph.step(dt);
+			}
+		}
+		saver.wait();
+		auto exported = std::chrono::steady_clock::now();
+		std::cerr << "frames: " << frame << ", " << std::chrono::duration <double>(exported - finished).count() << " s\n";
+		if (saver.getFailed() > 0) {
+			std::cerr << "|ERROR| GraphLayout: " << saver.getFailed() << " frames were not written to " << frames << '\n';
+			return 1;
+		}
+	}
+
+	if (!output.empty()) {
+		std::ofstream fout(output);
+		fout << graph.getLayout();
+	}
+	else if (frames.empty()) {
+		std::cout << graph.getLayout();
+	}
+
+	if (!png.empty()) {
+		target.clear(sf::Color(0, 0, 0, 255));
+		target.draw(graph);
+		target.display();
+		target.getTexture().copyToImage().saveToFile(png);
+	}
+
+	return 0;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include <cstring>
+#include <cstdint>
+
+// Binary save of a laid out graph, fixed-size little-endian fields, so it is written
+// with one write and read straight out of a mapping.
+//     "GDSV", version byte
+//     u32 n, u32 m, u32 next label
+//     n times: f32 x, f32 y, u32 color, u32 label
+//     m times: u32 u, u32 v, u32 color
+// Ids are 0-based, colors are 0xRRGGBBAA.
+namespace gsave {
+	const char magic[4] = { 'G', 'D', 'S', 'V' };
+	const unsigned char version = 1;
+
+	const size_t headerSize = 5 + 12;
+	const size_t nodeSize = 16;
+	const size_t edgeSize = 12;
+
+	inline void putU32(std::string& out, uint32_t val) {
+		char b[4] = { (char)val, (char)(val >> 8), (char)(val >> 16), (char)(val >> 24) };
+		out.append(b, 4);
+	}
+	inline void putFloat(std::string& out, float val) {
+		uint32_t bits;
+		std::memcpy(&bits, &val, 4);
+		putU32(out, bits);
+	}
+
+	inline uint32_t getU32(const char*& p) {
+		const unsigned char* b = (const unsigned char*)p;
+		p += 4;
+		return b[0] | (uint32_t)b[1] << 8 | (uint32_t)b[2] << 16 | (uint32_t)b[3] << 24;
+	}
+	inline float getFloat(const char*& p) {
+		uint32_t bits = getU32(p);
+		float val;
+		std::memcpy(&val, &bits, 4);
+		return val;
+	}
+
+	inline bool isSave(const char* p, size_t size) {
+		return size >= headerSize && std::memcmp(p, magic, 4) == 0 && (unsigned char)p[4] == version;
+	}
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <string>
+#include <istream>
+#include <cstdint>
+
+// Binary trace written by gdraw and replayed by the viewer.
+//     "GDRW", version byte
+//     varint n, varint m, m times varint u, varint v
+//     action groups until the end of file: varint count, count records
+// A record is one opcode byte and its varint arguments. Ids are 0-based,
+// colors are 0xRRGGBBAA as in the text format.
+namespace gtrace {
+	const char magic[4] = { 'G', 'D', 'R', 'W' };
+	const unsigned char version = 1;
+
+	enum Op : unsigned char {
+		NodeColor = 1,  // node, color
+		EdgeColor = 2,  // edge, color
+		EdgeAdd = 3,    // u, v
+		EdgeDelete = 4, // edge
+		EdgePop = 5,    // (none), undo of EdgeAdd
+		EdgeRevive = 6  // edge, undo of EdgeDelete
+	};
+
+	struct Record {
+		Op op = NodeColor;
+		uint32_t a = 0;
+		uint32_t b = 0;
+	};
+
+	inline int argCount(Op op) {
+		switch (op) {
+		case NodeColor:
+		case EdgeColor:
+		case EdgeAdd:
+			return 2;
+		case EdgeDelete:
+		case EdgeRevive:
+			return 1;
+		default:
+			return 0;
+		}
+	}
+
+	inline void putVarint(std::string& out, uint32_t val) {
+		while (val >= 0x80) {
+			out += (char)((val & 0x7f) | 0x80);
+			val >>= 7;
+		}
+		out += (char)val;
+	}
+
+	inline bool getVarint(const char*& p, const char* end, uint32_t& val) {
+		val = 0;
+		for (int shift = 0; shift < 35 && p < end; shift += 7) {
+			unsigned char c = *p++;
+			val |= (uint32_t)(c & 0x7f) << shift;
+			if (!(c & 0x80)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	inline void putRecord(std::string& out, const Record& rec) {
+		out += (char)rec.op;
+		int args = argCount(rec.op);
+		if (args > 0) {
+			putVarint(out, rec.a);
+		}
+		if (args > 1) {
+			putVarint(out, rec.b);
+		}
+	}
+
+	inline bool getRecord(const char*& p, const char* end, Record& rec) {
+		if (p >= end || *p < NodeColor || *p > EdgeRevive) {
+			return false;
+		}
+		rec.op = (Op)*p++;
+		rec.a = rec.b = 0;
+		int args = argCount(rec.op);
+		if (args > 0 && !getVarint(p, end, rec.a)) {
+			return false;
+		}
+		if (args > 1 && !getVarint(p, end, rec.b)) {
+			return false;
+		}
+		return true;
+	}
+
+	// one line of the text format: "nc v col", "ec e col", "ea u v" or "ed e" with 1-based ids,
+	// an unknown line is skipped
+	inline bool readText(std::istream& is, Record& rec) {
+		std::string type;
+		is >> type;
+		rec = Record();
+		if (type == "nc") {
+			rec.op = NodeColor;
+			is >> rec.a >> rec.b;
+		}
+		else if (type == "ec") {
+			rec.op = EdgeColor;
+			is >> rec.a >> rec.b;
+		}
+		else if (type == "ea") {
+			rec.op = EdgeAdd;
+			is >> rec.a >> rec.b;
+			--rec.b;
+		}
+		else if (type == "ed") {
+			rec.op = EdgeDelete;
+			is >> rec.a;
+		}
+		else {
+			std::string rest;
+			getline(is, rest);
+			return false;
+		}
+		--rec.a;
+		return (bool)is;
+	}
+
+	inline bool isBinary(const char* p, size_t size) {
+		return size >= 5 && std::string(p, 4) == std::string(magic, 4) && (unsigned char)p[4] == version;
+	}
+}
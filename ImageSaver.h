@@ -0,0 +1,107 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+
+// Encodes images into files on worker threads, so saving a frame costs the caller only
+// the copy out of the GPU. At most maxPending images wait in memory, save() blocks
+// beyond that, so a long export can not outrun the encoders and run out of memory.
+class ImageSaver {
+private:
+	struct Job {
+		sf::Image image;
+		std::string path;
+	};
+
+	std::vector <std::thread> worker;
+	std::mutex mtx;
+	std::condition_variable jobCv;
+	std::condition_variable roomCv;
+	std::condition_variable idleCv;
+	std::deque <Job> jobs;
+	int busy = 0;
+	int maxPending;
+	bool stop = false;
+	std::atomic <int> failed{ 0 };
+
+	void loop() {
+		while (true) {
+			Job job;
+			{
+				std::unique_lock <std::mutex> lock(mtx);
+				jobCv.wait(lock, [&] { return stop || !jobs.empty(); });
+				if (jobs.empty()) {
+					return;
+				}
+				job = std::move(jobs.front());
+				jobs.pop_front();
+				++busy;
+			}
+			roomCv.notify_one();
+			if (!job.image.saveToFile(job.path)) {
+				++failed;
+			}
+			{
+				std::lock_guard <std::mutex> lock(mtx);
+				--busy;
+			}
+			idleCv.notify_all();
+		}
+	}
+
+public:
+	ImageSaver(int threads = std::thread::hardware_concurrency(), int _maxPending = 0) {
+		threads = std::max(threads, 1);
+		maxPending = _maxPending > 0 ? _maxPending : threads * 2;
+		for (int t = 0; t < threads; ++t) {
+			worker.emplace_back(&ImageSaver::loop, this);
+		}
+	}
+	// images still waiting are saved first
+	~ImageSaver() {
+		{
+			std::lock_guard <std::mutex> lock(mtx);
+			stop = true;
+		}
+		jobCv.notify_all();
+		for (auto& th : worker) {
+			th.join();
+		}
+	}
+
+	ImageSaver(const ImageSaver&) = delete;
+	ImageSaver& operator=(const ImageSaver&) = delete;
+
+	// the format is taken from the extension of path, as sf::Image::saveToFile does
+	void save(sf::Image image, const std::string& path) {
+		{
+			std::unique_lock <std::mutex> lock(mtx);
+			roomCv.wait(lock, [&] { return jobs.size() < maxPending; });
+			jobs.push_back({ std::move(image), path });
+		}
+		jobCv.notify_one();
+	}
+
+	// returns when every image given so far is written
+	void wait() {
+		std::unique_lock <std::mutex> lock(mtx);
+		idleCv.wait(lock, [&] { return jobs.empty() && busy == 0; });
+	}
+
+	// images given but not written yet
+	int getPending() {
+		std::lock_guard <std::mutex> lock(mtx);
+		return jobs.size() + busy;
+	}
+	// images that could not be written
+	int getFailed() const {
+		return failed;
+	}
+};
@@ -0,0 +1,1001 @@
+#pragma once
+
+#include <SFML/System/Vector2.hpp>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <cmath>
+#include <iostream>
+#include <algorithm>
+#include <unordered_map>
+#include <limits>
+
+#include "Simd.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
+
+std::mt19937 rnd(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+float rnd01() {
+	return (double)rnd() / rnd.max();
+}
+
+const float force = 3;
+
+float length(const sf::Vector2f& vec) {
+	return sqrt(vec.x * vec.x + vec.y * vec.y);
+}
+
+// node scale of a freshly loaded graph with n nodes
+float layoutScale(int n) {
+	if (n == 0) {
+		return 1.f;
+	}
+	return std::min(20.f / n, 1.f);
+}
+
+// Barnes-Hut tree for node repulsion.
+// Pair (p, q) pushes p by (p - q) / |p - q|^2 * (scale_p^2 + scale_q^2) * force * 100^2,
+// which is what the all-pairs loop gives for (p, q) and (q, p) together.
+// A cell that is far enough (size / dist < theta) is replaced by its center of mass.
+class QuadTree {
+private:
+	struct Cell {
+		sf::Vector2f corner;
+		float size = 0;
+		sf::Vector2f massCenter;
+		int count = 0;
+		float scale2 = 0;
+		int child = -1; // first of 4 children, -1 for leaf
+		int first = -1; // first body of leaf
+	};
+
+	static const int maxDepth = 24;
+
+	std::vector <Cell> cell;
+	std::vector <int> next; // next body in the same leaf
+	const float* x = nullptr;
+	const float* y = nullptr;
+	const float* scale2 = nullptr;
+
+	int quarter(const Cell& c, const sf::Vector2f& p) const {
+		float half = c.size / 2;
+		return (p.x >= c.corner.x + half) | ((p.y >= c.corner.y + half) << 1);
+	}
+
+	void split(int c) {
+		int ch = cell.size();
+		float half = cell[c].size / 2;
+		for (int i = 0; i < 4; ++i) {
+			Cell sub;
+			sub.corner = cell[c].corner + sf::Vector2f((i & 1) * half, (i >> 1) * half);
+			sub.size = half;
+			cell.push_back(sub);
+		}
+		cell[c].child = ch;
+		int b = cell[c].first;
+		cell[c].first = -1;
+		while (b != -1) {
+			int nb = next[b];
+			int to = ch + quarter(cell[c], { x[b], y[b] });
+			next[b] = cell[to].first;
+			cell[to].first = b;
+			b = nb;
+		}
+	}
+
+	void insert(int b) {
+		int c = 0;
+		for (int depth = 0; ; ++depth) {
+			const sf::Vector2f p(x[b], y[b]);
+			cell[c].massCenter += p;
+			++cell[c].count;
+			cell[c].scale2 += scale2[b];
+			if (cell[c].child == -1) {
+				if (cell[c].first == -1 || depth == maxDepth) {
+					next[b] = cell[c].first;
+					cell[c].first = b;
+					return;
+				}
+				split(c);
+			}
+			c = cell[c].child + quarter(cell[c], p);
+		}
+	}
+
+public:
+	void build(const std::vector <float>& _x, const std::vector <float>& _y, const std::vector <float>& _scale2) {
+		x = _x.data();
+		y = _y.data();
+		scale2 = _scale2.data();
+		cell.clear();
+		next.assign(_x.size(), -1);
+		if (_x.empty()) {
+			return;
+		}
+
+		sf::Vector2f mn(x[0], y[0]), mx(x[0], y[0]);
+		for (int b = 0; b < _x.size(); ++b) {
+			mn.x = std::min(mn.x, x[b]);
+			mn.y = std::min(mn.y, y[b]);
+			mx.x = std::max(mx.x, x[b]);
+			mx.y = std::max(mx.y, y[b]);
+		}
+		Cell root;
+		root.corner = mn;
+		root.size = std::max(std::max(mx.x - mn.x, mx.y - mn.y), 1.f) * 1.0001f;
+		cell.push_back(root);
+
+		for (int b = 0; b < _x.size(); ++b) {
+			insert(b);
+		}
+		for (auto& c : cell) {
+			if (c.count > 0) {
+				c.massCenter /= (float)c.count;
+			}
+		}
+	}
+
+	// sum of (p - q) / |p - q|^2 * (scale_p^2 + scale_q^2) over all bodies q != b
+	sf::Vector2f repulsion(int b, float theta) const {
+		sf::Vector2f res;
+		if (cell.empty()) {
+			return res;
+		}
+		const sf::Vector2f p(x[b], y[b]);
+		const float s2 = scale2[b];
+		int stack[4 * maxDepth + 8];
+		int top = 0;
+		stack[top++] = 0;
+		while (top > 0) {
+			const Cell& c = cell[stack[--top]];
+			if (c.count == 0) {
+				continue;
+			}
+			if (c.child == -1) {
+				for (int q = c.first; q != -1; q = next[q]) {
+					sf::Vector2f vec = p - sf::Vector2f(x[q], y[q]);
+					float d2 = vec.x * vec.x + vec.y * vec.y;
+					if (d2 > 0) {
+						res += vec * ((s2 + scale2[q]) / d2);
+					}
+				}
+				continue;
+			}
+			sf::Vector2f vec = p - c.massCenter;
+			float d2 = vec.x * vec.x + vec.y * vec.y;
+			if (c.size * c.size < theta * theta * d2) {
+				res += vec * ((s2 * c.count + c.scale2) / d2);
+			}
+			else {
+				for (int i = 0; i < 4; ++i) {
+					stack[top++] = c.child + i;
+				}
+			}
+		}
+		return res;
+	}
+};
+
+
+// Force simulation of the graph, without anything to draw.
+// Node i and spring i here are node i and edge i of Graph.
+// State is kept as separate arrays so the kernels below run on FloatPack lanes.
+class Layout {
+public:
+	// advance runs update in fixed steps, the time left is carried to the next frame
+	static constexpr float fixedStep = 1 / 60.f;
+
+	enum class Repulsion {
+		AllPairs,
+		BarnesHut
+	};
+
+	struct Spring {
+		int u = 0;
+		int v = 0;
+		float optLen = 0;
+		bool alive = true;
+	};
+
+	// one edit of a layout; the edits written to a journal rebuild the layout on
+	// another one that replays them with apply (see Simulation)
+	struct Op {
+		enum Type : unsigned char {
+			Clear,
+			Reserve,        // a nodes, b springs
+			AddNode,        // at x, y with scale w
+			RemoveNode,     // a
+			SetPos,         // a to x, y
+			ClearVelocity,  // a
+			AddSpring,      // a, b of length x
+			RemoveSpring,   // a
+			SetSpringAlive, // a to b
+			SetRepulsion,   // a
+			SetTheta,       // x
+			SetBoard,       // size x, y, offset w, h
+			SetThreads      // a, never journaled, every layout has threads of its own
+		};
+		Type type = Clear;
+		int a = 0;
+		int b = 0;
+		float x = 0;
+		float y = 0;
+		float w = 0;
+		float h = 0;
+
+		// changes which node has which index
+		bool isNodeOp() const {
+			return type == Clear || type == AddNode || type == RemoveNode;
+		}
+	};
+
+private:
+	sf::Vector2f boardSize = { 1920, 1080 };
+	sf::Vector2f boardOffset = { 192, 108 };
+
+	std::vector <float> x;
+	std::vector <float> y;
+	std::vector <float> vx;
+	std::vector <float> vy;
+	std::vector <float> scale;
+	std::vector <float> scale2;
+
+	std::vector <int> springU;
+	std::vector <int> springV;
+	std::vector <float> springLen;
+	std::vector <float> springAlive; // 1 or 0
+
+	// springs of every node, where each spring sits in the lists of its two ends,
+	// and some spring for every pair of nodes that has one
+	std::vector <std::vector <int>> incident;
+	std::vector <int> springSlotU;
+	std::vector <int> springSlotV;
+	std::unordered_map <long long, int> pairSpring;
+
+	Repulsion repulsion = Repulsion::AllPairs;
+	float theta = 0.7f;
+	QuadTree tree;
+
+	// job t of the pool always takes the same rows and pulls the springs of its rows
+	// through rowStart / rowSpring (the incident lists in one array, rebuilt after the
+	// springs change), so every node is written by one thread and a step gives the same
+	// bits every time for the same number of threads
+	ThreadPool pool;
+	std::vector <int> rowStart;
+	std::vector <int> rowSpring;
+	bool rowsDirty = true;
+	std::vector <float> threadShift;
+	std::vector <float> threadEnergy;
+
+	float maxShift = 0;
+	float energy = 0; // mean squared speed of the nodes
+
+	static const int maxSubsteps = 4;
+	// asleep after sleepSteps steps in a row where no node moved more than sleepShift.
+	// Barnes-Hut keeps the nodes jittering, so the largest shift never gets that small
+	// there; with it the layout also sleeps once the energy has stopped falling. The energy
+	// is averaged over windows of sleepSteps steps, a window is flat if it is under
+	// settleFraction of the highest one since the layout woke and not settleDrop below the
+	// lowest one, and settleWindows flat windows in a row put the layout to sleep. A noisy
+	// window above the lowest one still counts as flat, only a real drop starts the count again.
+	static constexpr float sleepShift = 0.02f;
+	static const int sleepSteps = 60;
+	static constexpr float settleFraction = 0.05f;
+	static constexpr float settleDrop = 0.1f;
+	static const int settleWindows = 5;
+	float accumulator = 0;
+	int calmSteps = 0;
+	float windowEnergy = 0;
+	int windowSteps = 0;
+	float lowEnergy = std::numeric_limits <float>::max();
+	float peakEnergy = 0;
+	int flatWindows = 0;
+
+	std::vector <Op>* journal = nullptr;
+
+	void record(Op::Type type, int a = 0, int b = 0, float x = 0, float y = 0, float w = 0, float h = 0) {
+		if (journal != nullptr) {
+			journal->push_back({ type, a, b, x, y, w, h });
+		}
+	}
+	bool sleeping = false;
+
+	// Sum over j of (p_i - p_j) / |p_i - p_j|^2 * (scale_i^2 + scale_j^2) for j in [j, j + F::width).
+	// Times force * 100^2 it is what the old pairwise interact gave for (i, j) and (j, i) together.
+	template <class F>
+	void repulsionKernel(int i, int j, F& ax, F& ay) const {
+		F dx = F(x[i]) - F::load(&x[j]);
+		F dy = F(y[i]) - F::load(&y[j]);
+		F d2 = dx * dx + dy * dy;
+		F w = F::ifPositive(d2, (F(scale2[i]) + F::load(&scale2[j])) / d2);
+		ax = ax + dx * w;
+		ay = ay + dy * w;
+	}
+
+	void repulse(int from, int to, float time) {
+		const int n = x.size();
+		const float k = force * 10000.f * time;
+		for (int i = from; i < to; ++i) {
+			FloatPack ax, ay;
+			int j = 0;
+			for (; j + FloatPack::width <= n; j += FloatPack::width) {
+				repulsionKernel(i, j, ax, ay);
+			}
+			Float1 tx, ty;
+			for (; j < n; ++j) {
+				repulsionKernel(i, j, tx, ty);
+			}
+			vx[i] += (ax.sum() + tx.v) * k;
+			vy[i] += (ay.sum() + ty.v) * k;
+		}
+	}
+
+	void repulseTree(int from, int to, float time) {
+		const float k = force * 10000.f * time;
+		for (int i = from; i < to; ++i) {
+			sf::Vector2f acc = tree.repulsion(i, theta);
+			vx[i] += acc.x * k;
+			vy[i] += acc.y * k;
+		}
+	}
+
+	// springs [s, s + F::width): endpoints are gathered and the pushes scattered one by one into ax, ay
+	template <class F>
+	void springKernel(int s, float time, float* ax, float* ay) {
+		float ux[F::width], uy[F::width], wx[F::width], wy[F::width];
+		for (int l = 0; l < F::width; ++l) {
+			ux[l] = x[springU[s + l]];
+			uy[l] = y[springU[s + l]];
+			wx[l] = x[springV[s + l]];
+			wy[l] = y[springV[s + l]];
+		}
+		F dx = F::load(wx) - F::load(ux);
+		F dy = F::load(wy) - F::load(uy);
+		F d0 = sqrt(dx * dx + dy * dy);
+		// a dead spring or a loop does not pull
+		F k = F::ifPositive(F::load(&springAlive[s]) * d0, (d0 - F::load(&springLen[s])) / d0 * F(force * time));
+		float fx[F::width], fy[F::width];
+		(dx * k).store(fx);
+		(dy * k).store(fy);
+		for (int l = 0; l < F::width; ++l) {
+			ax[springU[s + l]] += fx[l];
+			ay[springU[s + l]] += fy[l];
+			ax[springV[s + l]] -= fx[l];
+			ay[springV[s + l]] -= fy[l];
+		}
+	}
+
+	void pull(int from, int to, float time, float* ax, float* ay) {
+		int s = from;
+		for (; s + FloatPack::width <= to; s += FloatPack::width) {
+			springKernel <FloatPack>(s, time, ax, ay);
+		}
+		for (; s < to; ++s) {
+			springKernel <Float1>(s, time, ax, ay);
+		}
+	}
+
+	void buildRows() {
+		const int n = x.size();
+		rowStart.assign(n + 1, 0);
+		for (int i = 0; i < n; ++i) {
+			rowStart[i + 1] = rowStart[i] + incident[i].size();
+		}
+		rowSpring.resize(rowStart[n]);
+		for (int i = 0; i < n; ++i) {
+			std::copy(incident[i].begin(), incident[i].end(), rowSpring.begin() + rowStart[i]);
+		}
+		rowsDirty = false;
+	}
+
+	// the same pushes as springKernel, gathered by the nodes [from, to) from their own springs
+	void pullRows(int from, int to, float time) {
+		const float k0 = force * time;
+		for (int i = from; i < to; ++i) {
+			float ax = 0, ay = 0;
+			for (int e = rowStart[i]; e < rowStart[i + 1]; ++e) {
+				int s = rowSpring[e];
+				int j = springU[s] == i ? springV[s] : springU[s];
+				float dx = x[j] - x[i];
+				float dy = y[j] - y[i];
+				float d0 = sqrt(dx * dx + dy * dy);
+				if (springAlive[s] > 0 && d0 > 0) {
+					float k = (d0 - springLen[s]) / d0 * k0;
+					ax += dx * k;
+					ay += dy * k;
+				}
+			}
+			vx[i] += ax;
+			vy[i] += ay;
+		}
+	}
+
+	// board walls, pull to the center, explicit Euler step and damping for [i, i + F::width)
+	template <class F>
+	void moveKernel(int i, float time, float damping, F& shift2, F& sum2) {
+		F px = F::load(&x[i]);
+		F py = F::load(&y[i]);
+		F vlx = F::load(&vx[i]);
+		F vly = F::load(&vy[i]);
+
+		F wall(force * time * 4.f);
+		F lx = max(F(boardOffset.x) - px, F(0.f));
+		F hx = max(px - F(boardSize.x - boardOffset.x), F(0.f));
+		F ly = max(F(boardOffset.y) - py, F(0.f));
+		F hy = max(py - F(boardSize.y - boardOffset.y), F(0.f));
+		vlx = vlx + (lx * lx - hx * hx) * wall;
+		vly = vly + (ly * ly - hy * hy) * wall;
+
+		F center = F(force / 3.0f * time) / F::load(&scale[i]);
+		vlx = vlx - (px - F(boardSize.x / 2.0f)) * center;
+		vly = vly - (py - F(boardSize.y / 2.0f)) * center;
+
+		F dt(time);
+		px = px + vlx * dt;
+		py = py + vly * dt;
+		vlx = vlx * F(damping);
+		vly = vly * F(damping);
+
+		px.store(&x[i]);
+		py.store(&y[i]);
+		vlx.store(&vx[i]);
+		vly.store(&vy[i]);
+
+		F v2 = vlx * vlx + vly * vly;
+		shift2 = max(shift2, v2);
+		sum2 = sum2 + v2;
+	}
+
+	// returns the largest squared speed after the step, sum2 gets the sum of them
+	float move(int from, int to, float time, float& sum2) {
+		const float damping = std::exp(-time);
+		FloatPack shift2, packSum;
+		int i = from;
+		for (; i + FloatPack::width <= to; i += FloatPack::width) {
+			moveKernel(i, time, damping, shift2, packSum);
+		}
+		Float1 tail, tailSum;
+		for (; i < to; ++i) {
+			moveKernel(i, time, damping, tail, tailSum);
+		}
+		sum2 = packSum.sum() + tailSum.v;
+		return std::max(shift2.max(), tail.v);
+	}
+
+	static long long pairKey(int u, int v) {
+		if (u > v) {
+			std::swap(u, v);
+		}
+		return (long long)u << 32 | (unsigned int)v;
+	}
+
+	void link(int s) {
+		rowsDirty = true;
+		springSlotU[s] = incident[springU[s]].size();
+		incident[springU[s]].push_back(s);
+		springSlotV[s] = incident[springV[s]].size();
+		incident[springV[s]].push_back(s);
+		pairSpring.emplace(pairKey(springU[s], springV[s]), s);
+	}
+
+	// swap-and-pop of entry pos in the list of node w
+	void unlinkEntry(int w, int pos) {
+		std::vector <int>& list = incident[w];
+		int last = list.size() - 1;
+		int t = list[last];
+		list[pos] = t;
+		list.pop_back();
+		if (pos != last) {
+			if (springU[t] == w && springSlotU[t] == last) {
+				springSlotU[t] = pos;
+			}
+			else {
+				springSlotV[t] = pos;
+			}
+		}
+	}
+
+	void unlink(int s) {
+		int u = springU[s];
+		int v = springV[s];
+		unlinkEntry(u, springSlotU[s]);
+		unlinkEntry(v, springSlotV[s]);
+		auto it = pairSpring.find(pairKey(u, v));
+		if (it->second == s) {
+			// another spring between u and v takes its place, the shorter list is searched
+			int other = -1;
+			for (int t : incident[incident[u].size() < incident[v].size() ? u : v]) {
+				if (pairKey(springU[t], springV[t]) == it->first) {
+					other = t;
+					break;
+				}
+			}
+			if (other == -1) {
+				pairSpring.erase(it);
+			}
+			else {
+				it->second = other;
+			}
+		}
+	}
+
+public:
+	void setBoard(const sf::Vector2f& size, const sf::Vector2f& offset) {
+		record(Op::SetBoard, 0, 0, size.x, size.y, offset.x, offset.y);
+		boardSize = size;
+		boardOffset = offset;
+		wake();
+	}
+	sf::Vector2f getBoardSize() const {
+		return boardSize;
+	}
+	sf::Vector2f getBoardOffset() const {
+		return boardOffset;
+	}
+
+	void setRepulsion(Repulsion _repulsion) {
+		record(Op::SetRepulsion, (int)_repulsion);
+		repulsion = _repulsion;
+		wake();
+	}
+	Repulsion getRepulsion() const {
+		return repulsion;
+	}
+	void setTheta(float _theta) {
+		record(Op::SetTheta, 0, 0, _theta);
+		theta = _theta;
+		wake();
+	}
+
+	void setThreads(int threads) {
+		pool.resize(std::max(threads, 1));
+	}
+	int getThreads() const {
+		return pool.size();
+	}
+
+	void update(float time) {
+		const int n = x.size();
+		const int m = springU.size();
+		const int threads = pool.size();
+
+		if (repulsion == Repulsion::BarnesHut) {
+			ProfileScope scope("tree");
+			tree.build(x, y, scale2);
+		}
+		if (threads == 1) {
+			{
+				ProfileScope scope("repulsion");
+				if (repulsion == Repulsion::BarnesHut) {
+					repulseTree(0, n, time);
+				}
+				else {
+					repulse(0, n, time);
+				}
+			}
+			{
+				ProfileScope scope("springs");
+				pull(0, m, time, vx.data(), vy.data());
+			}
+			ProfileScope scope("move");
+			float sum2;
+			maxShift = sqrt(move(0, n, time, sum2)) * time;
+			energy = n > 0 ? sum2 / n : 0;
+			return;
+		}
+
+		if (rowsDirty) {
+			ProfileScope scope("rows");
+			buildRows();
+		}
+		threadShift.resize(threads);
+		threadEnergy.resize(threads);
+		pool.run([&](int t) {
+			ProfileScope scope("repulsion");
+			auto [from, to] = pool.range(n, t);
+			if (repulsion == Repulsion::BarnesHut) {
+				repulseTree(from, to, time);
+			}
+			else {
+				repulse(from, to, time);
+			}
+			scope.end();
+
+			ProfileScope springScope("springs");
+			pullRows(from, to, time);
+		});
+		pool.run([&](int t) {
+			ProfileScope scope("move");
+			auto [from, to] = pool.range(n, t, FloatPack::width);
+			threadShift[t] = move(from, to, time, threadEnergy[t]);
+		});
+		maxShift = sqrt(*std::max_element(threadShift.begin(), threadShift.end())) * time;
+		float sum2 = 0;
+		for (float e : threadEnergy) {
+			sum2 += e;
+		}
+		energy = n > 0 ? sum2 / n : 0;
+	}
+
+	// frameTime of real time as whole steps of fixedStep; after a hitch at most maxSubsteps
+	// of them are run and the rest is dropped, so a slow frame never makes one big step
+	void advance(float frameTime) {
+		if (sleeping) {
+			return;
+		}
+		accumulator += frameTime;
+		int steps = 0;
+		while (accumulator >= fixedStep && steps < maxSubsteps) {
+			accumulator -= fixedStep;
+			++steps;
+			if (!step()) {
+				return;
+			}
+		}
+		accumulator = std::min(accumulator, fixedStep);
+	}
+
+	// one step of fixedStep, false once it has put the layout to sleep
+	bool step() {
+		update(fixedStep);
+		calmSteps = maxShift < sleepShift ? calmSteps + 1 : 0;
+		windowEnergy += energy;
+		if (++windowSteps == sleepSteps) {
+			float mean = windowEnergy / sleepSteps;
+			peakEnergy = std::max(peakEnergy, mean);
+			if (mean < lowEnergy * (1 - settleDrop)) {
+				lowEnergy = mean;
+				flatWindows = 0;
+			}
+			else if (mean < peakEnergy * settleFraction) {
+				++flatWindows;
+			}
+			else {
+				flatWindows = 0;
+			}
+			windowEnergy = 0;
+			windowSteps = 0;
+		}
+		bool settled = repulsion == Repulsion::BarnesHut && flatWindows >= settleWindows;
+		if (calmSteps >= sleepSteps || settled) {
+			sleeping = true;
+			accumulator = 0;
+		}
+		return !sleeping;
+	}
+
+	// every change of nodes or springs wakes the layout
+	void wake() {
+		sleeping = false;
+		calmSteps = 0;
+		windowEnergy = 0;
+		windowSteps = 0;
+		lowEnergy = std::numeric_limits <float>::max();
+		peakEnergy = 0;
+		flatWindows = 0;
+	}
+	bool isSleeping() const {
+		return sleeping;
+	}
+
+	// the largest distance a node will move on the next step if nothing pushes it
+	float getMaxShift() const {
+		return maxShift;
+	}
+
+	void clear() {
+		record(Op::Clear);
+		x.clear();
+		y.clear();
+		vx.clear();
+		vy.clear();
+		scale.clear();
+		scale2.clear();
+		springU.clear();
+		springV.clear();
+		springLen.clear();
+		springAlive.clear();
+		incident.clear();
+		springSlotU.clear();
+		springSlotV.clear();
+		pairSpring.clear();
+		rowsDirty = true;
+		wake();
+	}
+
+	int size() const {
+		return x.size();
+	}
+	int springCount() const {
+		return springU.size();
+	}
+
+	// room for n nodes and m springs, so loading a big graph does not regrow anything
+	void reserve(int n, int m) {
+		record(Op::Reserve, n, m);
+		x.reserve(n);
+		y.reserve(n);
+		vx.reserve(n);
+		vy.reserve(n);
+		scale.reserve(n);
+		scale2.reserve(n);
+		incident.reserve(n);
+		springU.reserve(m);
+		springV.reserve(m);
+		springLen.reserve(m);
+		springAlive.reserve(m);
+		springSlotU.reserve(m);
+		springSlotV.reserve(m);
+		pairSpring.reserve(m);
+	}
+
+	int addNode(const sf::Vector2f& p, float sc) {
+		record(Op::AddNode, 0, 0, p.x, p.y, sc);
+		x.push_back(p.x);
+		y.push_back(p.y);
+		vx.push_back(0);
+		vy.push_back(0);
+		scale.push_back(sc);
+		scale2.push_back(sc * sc);
+		incident.emplace_back();
+		rowsDirty = true;
+		wake();
+		return x.size() - 1;
+	}
+	// springs of the node must be removed before, the last node takes index i
+	void removeNode(int i) {
+		record(Op::RemoveNode, i);
+		int last = x.size() - 1;
+		if (i != last) {
+			x[i] = x[last];
+			y[i] = y[last];
+			vx[i] = vx[last];
+			vy[i] = vy[last];
+			scale[i] = scale[last];
+			scale2[i] = scale2[last];
+			for (int s : incident[last]) {
+				auto it = pairSpring.find(pairKey(springU[s], springV[s]));
+				bool keyed = it != pairSpring.end() && it->second == s;
+				if (keyed) {
+					pairSpring.erase(it);
+				}
+				springU[s] = springU[s] == last ? i : springU[s];
+				springV[s] = springV[s] == last ? i : springV[s];
+				if (keyed) {
+					pairSpring.emplace(pairKey(springU[s], springV[s]), s);
+				}
+			}
+			incident[i].swap(incident[last]);
+		}
+		x.pop_back();
+		y.pop_back();
+		vx.pop_back();
+		vy.pop_back();
+		scale.pop_back();
+		scale2.pop_back();
+		incident.pop_back();
+		rowsDirty = true;
+		wake();
+	}
+
+	sf::Vector2f getPos(int i) const {
+		return { x[i], y[i] };
+	}
+	void setPos(int i, const sf::Vector2f& p) {
+		record(Op::SetPos, i, 0, p.x, p.y);
+		x[i] = p.x;
+		y[i] = p.y;
+		wake();
+	}
+	void clearVelocity(int i) {
+		record(Op::ClearVelocity, i);
+		vx[i] = 0;
+		vy[i] = 0;
+	}
+
+	int addSpring(int u, int v, float optLen) {
+		record(Op::AddSpring, u, v, optLen);
+		springU.push_back(u);
+		springV.push_back(v);
+		springLen.push_back(optLen);
+		springAlive.push_back(1);
+		springSlotU.push_back(0);
+		springSlotV.push_back(0);
+		link(springU.size() - 1);
+		wake();
+		return springU.size() - 1;
+	}
+	// springs of 0-based edges, every list of incident springs is allocated once
+	void addSprings(const std::vector <std::pair <int, int>>& edges, float optLen) {
+		std::vector <int> degree(incident.size(), 0);
+		for (auto [u, v] : edges) {
+			++degree[u];
+			++degree[v];
+		}
+		for (int i = 0; i < incident.size(); ++i) {
+			incident[i].reserve(incident[i].size() + degree[i]);
+		}
+		reserve(x.size(), springU.size() + edges.size());
+		for (auto [u, v] : edges) {
+			addSpring(u, v, optLen);
+		}
+	}
+	// the last spring takes index i
+	void removeSpring(int i) {
+		record(Op::RemoveSpring, i);
+		unlink(i);
+		int last = springU.size() - 1;
+		if (i != last) {
+			springU[i] = springU[last];
+			springV[i] = springV[last];
+			springLen[i] = springLen[last];
+			springAlive[i] = springAlive[last];
+			springSlotU[i] = springSlotU[last];
+			springSlotV[i] = springSlotV[last];
+			incident[springU[i]][springSlotU[i]] = i;
+			incident[springV[i]][springSlotV[i]] = i;
+			auto it = pairSpring.find(pairKey(springU[i], springV[i]));
+			if (it->second == last) {
+				it->second = i;
+			}
+		}
+		springU.pop_back();
+		springV.pop_back();
+		springLen.pop_back();
+		springAlive.pop_back();
+		springSlotU.pop_back();
+		springSlotV.pop_back();
+		rowsDirty = true;
+		wake();
+	}
+	void popSpring() {
+		removeSpring(springU.size() - 1);
+	}
+	// some spring between u and v, -1 if there is none
+	int findSpring(int u, int v) const {
+		auto it = pairSpring.find(pairKey(u, v));
+		return it == pairSpring.end() ? -1 : it->second;
+	}
+	const std::vector <int>& getIncident(int v) const {
+		return incident[v];
+	}
+	Spring getSpring(int i) const {
+		Spring sp;
+		sp.u = springU[i];
+		sp.v = springV[i];
+		sp.optLen = springLen[i];
+		sp.alive = springAlive[i] > 0;
+		return sp;
+	}
+	void setSpringAlive(int i, bool alive) {
+		if (springAlive[i] != alive) {
+			record(Op::SetSpringAlive, i, alive);
+			springAlive[i] = alive;
+			wake();
+		}
+	}
+
+	// every edit from now on is also written to ops, nullptr - to nothing
+	void setJournal(std::vector <Op>* ops) {
+		journal = ops;
+	}
+
+	void apply(const Op& op) {
+		switch (op.type) {
+		case Op::Clear:
+			clear();
+			break;
+		case Op::Reserve:
+			reserve(op.a, op.b);
+			break;
+		case Op::AddNode:
+			addNode({ op.x, op.y }, op.w);
+			break;
+		case Op::RemoveNode:
+			removeNode(op.a);
+			break;
+		case Op::SetPos:
+			setPos(op.a, { op.x, op.y });
+			break;
+		case Op::ClearVelocity:
+			clearVelocity(op.a);
+			break;
+		case Op::AddSpring:
+			addSpring(op.a, op.b, op.x);
+			break;
+		case Op::RemoveSpring:
+			removeSpring(op.a);
+			break;
+		case Op::SetSpringAlive:
+			setSpringAlive(op.a, op.b != 0);
+			break;
+		case Op::SetRepulsion:
+			setRepulsion((Repulsion)op.a);
+			break;
+		case Op::SetTheta:
+			setTheta(op.x);
+			break;
+		case Op::SetBoard:
+			setBoard({ op.x, op.y }, { op.w, op.h });
+			break;
+		case Op::SetThreads:
+			setThreads(op.a);
+			break;
+		}
+	}
+
+	// ops that build this layout on an empty one (velocities are not kept)
+	void describe(std::vector <Op>& ops) const {
+		ops.push_back({ Op::Clear });
+		ops.push_back({ Op::SetBoard, 0, 0, boardSize.x, boardSize.y, boardOffset.x, boardOffset.y });
+		ops.push_back({ Op::SetRepulsion, (int)repulsion });
+		ops.push_back({ Op::SetTheta, 0, 0, theta });
+		ops.push_back({ Op::Reserve, size(), springCount() });
+		for (int i = 0; i < size(); ++i) {
+			ops.push_back({ Op::AddNode, 0, 0, x[i], y[i], scale[i] });
+		}
+		for (int i = 0; i < springCount(); ++i) {
+			ops.push_back({ Op::AddSpring, springU[i], springV[i], springLen[i] });
+			if (springAlive[i] == 0) {
+				ops.push_back({ Op::SetSpringAlive, i, 0 });
+			}
+		}
+	}
+
+	// positions of all nodes as another layout with the same nodes has them;
+	// not journaled, this is how the copy that runs the physics is shown
+	void getPositions(std::vector <float>& px, std::vector <float>& py) const {
+		px = x;
+		py = y;
+	}
+	// positions of a layout that replayed this one's journal up to some point; the moves
+	// journaled after that point are put back on top, so a node just placed does not jump back
+	template <class Ops>
+	void setPositions(const std::vector <float>& px, const std::vector <float>& py, const Ops& after) {
+		x = px;
+		y = py;
+		for (const Op& op : after) {
+			if (op.type == Op::SetPos && op.a < x.size()) {
+				x[op.a] = op.x;
+				y[op.a] = op.y;
+			}
+		}
+	}
+
+	// clears the layout and puts n nodes at random points of the board
+	void scatter(int n) {
+		clear();
+		float scale = layoutScale(n);
+		for (int i = 0; i < n; ++i) {
+			addNode({
+				rnd01() * (boardSize.x - 2 * boardOffset.x) + boardOffset.x,
+				rnd01() * (boardSize.y - 2 * boardOffset.y) + boardOffset.y },
+				sqrt(scale));
+		}
+	}
+
+	// reads "n m" and m edges "u v" (1-based), nodes are scattered over the board
+	friend std::istream& operator>>(std::istream& is, Layout& layout) {
+		int n, m;
+		is >> n >> m;
+		layout.scatter(n);
+		std::vector <std::pair <int, int>> edges(m);
+		for (auto& [u, v] : edges) {
+			is >> u >> v;
+			--u;
+			--v;
+		}
+		layout.addSprings(edges, 200 * layoutScale(n));
+
+		return is;
+	}
+
+	// "n" and then "id x y" for every node
+	friend std::ostream& operator<<(std::ostream& os, const Layout& layout) {
+		os << layout.size() << '\n';
+		for (int i = 0; i < layout.size(); ++i) {
+			os << i + 1 << ' ' << layout.x[i] << ' ' << layout.y[i] << '\n';
+		}
+		return os;
+	}
+};
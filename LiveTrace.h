@@ -0,0 +1,259 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <cctype>
+
+#include "GraphTrace.h"
+
+// Follows a trace (text or binary) while it is still being written, from a file
+// or a named pipe. A reader thread takes complete groups out of what has arrived
+// so far and queues them, the render loop picks them up without waiting on I/O.
+class LiveTrace {
+private:
+	// shared with the reader thread, which may outlive close() while it is blocked on a pipe
+	struct State {
+		std::atomic <bool> stop{ false };
+		std::atomic <bool> done{ false };
+
+		std::mutex mtx;
+		bool headerReady = false;
+		int nodes = 0;
+		std::vector <std::pair <int, int>> edges;
+		std::deque <std::vector <gtrace::Record>> groups;
+	};
+
+	// what the reader has received but not parsed yet
+	struct Parser {
+		std::string buf;
+		size_t pos = 0;
+		int format = -1; // -1 unknown yet, 0 text, 1 binary
+		bool header = false;
+
+		// end of the count-th complete line starting at pos, npos if it has not arrived yet
+		size_t linesEnd(int count) const {
+			size_t end = pos;
+			for (int i = 0; i < count; ++i) {
+				end = buf.find('\n', end);
+				if (end == std::string::npos) {
+					return end;
+				}
+				++end;
+			}
+			return end;
+		}
+
+		bool parseText(State& st) {
+			while (pos < buf.size() && isspace((unsigned char)buf[pos])) {
+				++pos;
+			}
+			size_t first = linesEnd(1);
+			if (first == std::string::npos) {
+				return false;
+			}
+			std::istringstream head(buf.substr(pos, first - pos));
+			int n = 0, m = 0;
+			if (!(head >> n) || n < 0 || (!header && (!(head >> m) || m < 0))) {
+				pos = first;
+				return true;
+			}
+			size_t end = header ? linesEnd(n + 1) : linesEnd(m + 1);
+			if (end == std::string::npos) {
+				return false;
+			}
+			std::istringstream is(buf.substr(first, end - first));
+			if (!header) {
+				std::vector <std::pair <int, int>> edges(m);
+				for (auto& [u, v] : edges) {
+					is >> u >> v;
+					--u; --v;
+				}
+				publishHeader(st, n, edges);
+			}
+			else {
+				std::vector <gtrace::Record> group;
+				gtrace::Record rec;
+				for (int i = 0; i < n; ++i) {
+					if (gtrace::readText(is, rec)) {
+						group.push_back(rec);
+					}
+				}
+				publishGroup(st, group);
+			}
+			pos = end;
+			return true;
+		}
+
+		bool parseBinary(State& st) {
+			const char* p = buf.data() + pos;
+			const char* end = buf.data() + buf.size();
+			if (!header) {
+				if (end - p < 5) {
+					return false;
+				}
+				p += 5;
+				uint32_t n, m;
+				if (!gtrace::getVarint(p, end, n) || !gtrace::getVarint(p, end, m)) {
+					return false;
+				}
+				std::vector <std::pair <int, int>> edges(m);
+				for (auto& [u, v] : edges) {
+					uint32_t a, b;
+					if (!gtrace::getVarint(p, end, a) || !gtrace::getVarint(p, end, b)) {
+						return false;
+					}
+					u = a;
+					v = b;
+				}
+				publishHeader(st, n, edges);
+			}
+			else {
+				uint32_t cnt;
+				if (!gtrace::getVarint(p, end, cnt)) {
+					return false;
+				}
+				std::vector <gtrace::Record> group(cnt);
+				for (auto& rec : group) {
+					if (!gtrace::getRecord(p, end, rec)) {
+						return false;
+					}
+				}
+				publishGroup(st, group);
+			}
+			pos = p - buf.data();
+			return true;
+		}
+
+		void publishHeader(State& st, int n, std::vector <std::pair <int, int>>& edges) {
+			std::lock_guard <std::mutex> lock(st.mtx);
+			st.nodes = n;
+			st.edges.swap(edges);
+			st.headerReady = true;
+			header = true;
+		}
+		void publishGroup(State& st, std::vector <gtrace::Record>& group) {
+			std::lock_guard <std::mutex> lock(st.mtx);
+			st.groups.push_back(std::move(group));
+		}
+
+		void append(State& st, const char* data, size_t size) {
+			buf.append(data, size);
+			if (format == -1) {
+				if (buf[0] != gtrace::magic[0]) {
+					format = 0;
+				}
+				else if (buf.size() >= 5) {
+					format = gtrace::isBinary(buf.data(), buf.size()) ? 1 : 0;
+				}
+				else {
+					return;
+				}
+			}
+			while (format == 1 ? parseBinary(st) : parseText(st)) {}
+			buf.erase(0, pos);
+			pos = 0;
+		}
+	};
+
+	static void readerLoop(std::shared_ptr <State> st, std::string path) {
+		// opening a pipe waits here for the writer
+		std::ifstream in(path, std::ios::binary);
+		std::streambuf* sb = in.rdbuf();
+		Parser parser;
+		std::vector <char> chunk(1 << 16);
+		while (in.is_open() && !st->stop) {
+			// sgetc returns as soon as anything arrives, in_avail is how much of it is buffered
+			if (sb->sgetc() == std::char_traits <char>::eof()) {
+				// MSVC's filebuf reads through a FILE* whose end-of-file flag sticks, seeking
+				// to where we are clears it, so the next sgetc sees what was appended since.
+				// A pipe can not seek and has no such flag
+				std::streampos at = sb->pubseekoff(0, std::ios::cur, std::ios::in);
+				if (at != std::streampos(-1)) {
+					sb->pubseekpos(at, std::ios::in);
+				}
+				std::this_thread::sleep_for(std::chrono::milliseconds(5));
+				continue;
+			}
+			std::streamsize got = sb->sgetn(chunk.data(), std::min <std::streamsize>(sb->in_avail(), chunk.size()));
+			parser.append(*st, chunk.data(), got);
+		}
+		st->done = true;
+	}
+
+	std::shared_ptr <State> state;
+	std::thread reader;
+
+public:
+	LiveTrace() {}
+	~LiveTrace() {
+		close();
+	}
+
+	LiveTrace(const LiveTrace&) = delete;
+	LiveTrace& operator=(const LiveTrace&) = delete;
+
+	void open(const std::string& path) {
+		close();
+		state = std::make_shared <State>();
+		reader = std::thread(readerLoop, state, path);
+	}
+
+	// a reader still blocked on a silent pipe is left to finish on its own
+	void close() {
+		if (!state) {
+			return;
+		}
+		state->stop = true;
+		for (int i = 0; i < 100 && !state->done; ++i) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		if (state->done) {
+			reader.join();
+		}
+		else {
+			reader.detach();
+		}
+		state.reset();
+	}
+
+	bool isOpen() const {
+		return (bool)state;
+	}
+
+	// graph of the trace, once its header has arrived
+	bool takeHeader(int& nodes, std::vector <std::pair <int, int>>& edges) {
+		if (!state) {
+			return false;
+		}
+		std::lock_guard <std::mutex> lock(state->mtx);
+		if (!state->headerReady) {
+			return false;
+		}
+		nodes = state->nodes;
+		edges.swap(state->edges);
+		state->headerReady = false;
+		return true;
+	}
+
+	// moves all complete groups received so far to out
+	void takeGroups(std::vector <std::vector <gtrace::Record>>& out) {
+		out.clear();
+		if (!state) {
+			return;
+		}
+		std::lock_guard <std::mutex> lock(state->mtx);
+		while (!state->groups.empty()) {
+			out.push_back(std::move(state->groups.front()));
+			state->groups.pop_front();
+		}
+	}
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Read-only memory mapping of a whole file.
+class MappedFile {
+private:
+	const char* ptr = nullptr;
+	size_t sz = 0;
+#ifdef _WIN32
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = nullptr;
+#endif
+
+public:
+	MappedFile() {}
+	~MappedFile() {
+		close();
+	}
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool open(const std::string& path) {
+		close();
+#ifdef _WIN32
+		file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+		LARGE_INTEGER size;
+		GetFileSizeEx(file, &size);
+		sz = size.QuadPart;
+		if (sz == 0) {
+			return true;
+		}
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping == nullptr) {
+			close();
+			return false;
+		}
+		ptr = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			return false;
+		}
+		struct stat st;
+		fstat(fd, &st);
+		sz = st.st_size;
+		if (sz > 0) {
+			void* p = mmap(nullptr, sz, PROT_READ, MAP_PRIVATE, fd, 0);
+			ptr = p == MAP_FAILED ? nullptr : (const char*)p;
+		}
+		::close(fd);
+#endif
+		if (sz > 0 && ptr == nullptr) {
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	void close() {
+#ifdef _WIN32
+		if (ptr != nullptr) {
+			UnmapViewOfFile(ptr);
+		}
+		if (mapping != nullptr) {
+			CloseHandle(mapping);
+		}
+		if (file != INVALID_HANDLE_VALUE) {
+			CloseHandle(file);
+		}
+		mapping = nullptr;
+		file = INVALID_HANDLE_VALUE;
+#else
+		if (ptr != nullptr) {
+			munmap((void*)ptr, sz);
+		}
+#endif
+		ptr = nullptr;
+		sz = 0;
+	}
+
+	const char* data() const {
+		return ptr;
+	}
+	size_t size() const {
+		return sz;
+	}
+};
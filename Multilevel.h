@@ -0,0 +1,258 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#include "Layout.h"
+
+// Initial placement for big graphs, after Walshaw's multilevel force-directed method.
+// The graph is coarsened by matching and collapsing edges down to a few nodes, the
+// coarsest graph is laid out from random points, then each finer level starts with
+// its nodes at their coarse node and is refined by Fruchterman-Reingold steps with
+// Barnes-Hut repulsion. Lengths are in units of the natural spring length, the
+// finest level is scaled to the size the simulation would settle at.
+class Multilevel {
+private:
+	struct Level {
+		int n = 0;
+		std::vector <int> adjStart; // neighbours of v are adj[adjStart[v]..adjStart[v + 1])
+		std::vector <int> adj;
+		std::vector <float> weight; // nodes of the finest graph collapsed into this one
+		std::vector <int> parent;   // node of the next coarser level
+	};
+
+	std::vector <Level> levels;
+	std::vector <float> x;
+	std::vector <float> y;
+	std::vector <float> dx;
+	std::vector <float> dy;
+	std::vector <float> halfWeight;
+	QuadTree tree;
+
+	static const int coarsestSize = 8;
+	static constexpr float theta = 1.2f;
+	static constexpr float gravity = 0.02f;
+
+	static void makeAdjacency(Level& lv, std::vector <std::pair <int, int>>& edges) {
+		for (auto& [u, v] : edges) {
+			if (u > v) {
+				std::swap(u, v);
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+		edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+		lv.adjStart.assign(lv.n + 1, 0);
+		for (auto [u, v] : edges) {
+			if (u != v) {
+				++lv.adjStart[u + 1];
+				++lv.adjStart[v + 1];
+			}
+		}
+		for (int v = 0; v < lv.n; ++v) {
+			lv.adjStart[v + 1] += lv.adjStart[v];
+		}
+		lv.adj.resize(lv.adjStart[lv.n]);
+		std::vector <int> fill(lv.adjStart.begin(), lv.adjStart.end() - 1);
+		for (auto [u, v] : edges) {
+			if (u != v) {
+				lv.adj[fill[u]++] = v;
+				lv.adj[fill[v]++] = u;
+			}
+		}
+	}
+
+	// every node is matched with its lightest free neighbour, a node left without a pair
+	// joins the cluster of a neighbour, so stars collapse as fast as paths
+	bool coarsen() {
+		Level& fine = levels.back();
+		std::vector <int> order(fine.n);
+		for (int v = 0; v < fine.n; ++v) {
+			order[v] = v;
+		}
+		std::shuffle(order.begin(), order.end(), rnd);
+
+		fine.parent.assign(fine.n, -1);
+		int cn = 0;
+		for (int v : order) {
+			if (fine.parent[v] != -1) {
+				continue;
+			}
+			int best = -1;
+			for (int i = fine.adjStart[v]; i < fine.adjStart[v + 1]; ++i) {
+				int u = fine.adj[i];
+				if (fine.parent[u] == -1 && (best == -1 || fine.weight[u] < fine.weight[best])) {
+					best = u;
+				}
+			}
+			if (best != -1) {
+				fine.parent[v] = fine.parent[best] = cn++;
+			}
+		}
+		for (int v : order) {
+			if (fine.parent[v] != -1) {
+				continue;
+			}
+			int best = -1;
+			for (int i = fine.adjStart[v]; i < fine.adjStart[v + 1]; ++i) {
+				int u = fine.adj[i];
+				if (fine.parent[u] != -1 && (best == -1 || fine.weight[u] < fine.weight[best])) {
+					best = u;
+				}
+			}
+			fine.parent[v] = best != -1 ? fine.parent[best] : cn++;
+		}
+		// isolated nodes and what is left of them do not shrink any more
+		if (cn > fine.n * 0.9f) {
+			return false;
+		}
+
+		Level coarse;
+		coarse.n = cn;
+		coarse.weight.assign(cn, 0.f);
+		for (int v = 0; v < fine.n; ++v) {
+			coarse.weight[fine.parent[v]] += fine.weight[v];
+		}
+		std::vector <std::pair <int, int>> edges;
+		for (int v = 0; v < fine.n; ++v) {
+			for (int i = fine.adjStart[v]; i < fine.adjStart[v + 1]; ++i) {
+				int u = fine.adj[i];
+				if (u > v && fine.parent[u] != fine.parent[v]) {
+					edges.push_back({ fine.parent[v], fine.parent[u] });
+				}
+			}
+		}
+		makeAdjacency(coarse, edges);
+		levels.push_back(std::move(coarse));
+		return true;
+	}
+
+	// Fruchterman-Reingold with natural length 1: neighbours attract by d^2, all pairs
+	// repel by 1 / d (heavier clusters more), a node moves at most temperature per step
+	void refine(const Level& lv, int iterations, float temperature) {
+		halfWeight.resize(lv.n);
+		for (int v = 0; v < lv.n; ++v) {
+			halfWeight[v] = lv.weight[v] / 2;
+		}
+		dx.resize(lv.n);
+		dy.resize(lv.n);
+		for (int it = 0; it < iterations; ++it) {
+			float cx = 0, cy = 0;
+			for (int v = 0; v < lv.n; ++v) {
+				cx += x[v];
+				cy += y[v];
+			}
+			cx /= lv.n;
+			cy /= lv.n;
+
+			tree.build(x, y, halfWeight);
+			for (int v = 0; v < lv.n; ++v) {
+				sf::Vector2f rep = tree.repulsion(v, theta);
+				float fx = rep.x + (cx - x[v]) * gravity;
+				float fy = rep.y + (cy - y[v]) * gravity;
+				for (int i = lv.adjStart[v]; i < lv.adjStart[v + 1]; ++i) {
+					int u = lv.adj[i];
+					float ex = x[u] - x[v];
+					float ey = y[u] - y[v];
+					float d = std::sqrt(ex * ex + ey * ey);
+					fx += ex * d;
+					fy += ey * d;
+				}
+				dx[v] = fx;
+				dy[v] = fy;
+			}
+			for (int v = 0; v < lv.n; ++v) {
+				float d = std::sqrt(dx[v] * dx[v] + dy[v] * dy[v]);
+				if (d > 0) {
+					float k = std::min(d, temperature) / d;
+					x[v] += dx[v] * k;
+					y[v] += dy[v] * k;
+				}
+			}
+			temperature *= 0.92f;
+		}
+	}
+
+public:
+	// graphs smaller than that unfold quickly enough from random points
+	static const int minNodes = 100;
+
+	// positions of all nodes of layout from its alive springs
+	void place(Layout& layout) {
+		const int n = layout.size();
+		if (n < minNodes) {
+			return;
+		}
+
+		levels.assign(1, Level());
+		Level& finest = levels[0];
+		finest.n = n;
+		finest.weight.assign(n, 1.f);
+		std::vector <std::pair <int, int>> edges;
+		for (int i = 0; i < layout.springCount(); ++i) {
+			Layout::Spring sp = layout.getSpring(i);
+			if (sp.alive) {
+				edges.push_back({ sp.u, sp.v });
+			}
+		}
+		makeAdjacency(finest, edges);
+		while (levels.back().n > coarsestSize && coarsen()) {}
+
+		const Level& coarsest = levels.back();
+		float side = std::sqrt((float)coarsest.n);
+		x.resize(coarsest.n);
+		y.resize(coarsest.n);
+		for (int v = 0; v < coarsest.n; ++v) {
+			x[v] = rnd01() * side;
+			y[v] = rnd01() * side;
+		}
+		refine(coarsest, 150, side);
+
+		for (int l = (int)levels.size() - 2; l >= 0; --l) {
+			const Level& fine = levels[l];
+			const Level& coarse = levels[l + 1];
+			// a level of n nodes takes about n square units
+			float grow = std::sqrt((float)fine.n / coarse.n);
+			std::vector <float> cx = x, cy = y;
+			x.resize(fine.n);
+			y.resize(fine.n);
+			for (int v = 0; v < fine.n; ++v) {
+				x[v] = cx[fine.parent[v]] * grow + (rnd01() - 0.5f) * 0.5f;
+				y[v] = cy[fine.parent[v]] * grow + (rnd01() - 0.5f) * 0.5f;
+			}
+			refine(fine, l == 0 ? 30 : 20, 2.f);
+		}
+
+		// nodes repel by 1 / d and are pulled to the center, so the layout settles into a disc
+		// where the two balance: R^2 = 6 * 10^4 * s^3 * n for node scale s, rms radius R / sqrt(2)
+		float cx = 0, cy = 0;
+		for (int v = 0; v < n; ++v) {
+			cx += x[v];
+			cy += y[v];
+		}
+		cx /= n;
+		cy /= n;
+		float rms = 0;
+		for (int v = 0; v < n; ++v) {
+			rms += (x[v] - cx) * (x[v] - cx) + (y[v] - cy) * (y[v] - cy);
+		}
+		rms = std::sqrt(rms / n);
+		float s = std::sqrt(layoutScale(n));
+		float target = std::sqrt(3e4f * s * s * s * n);
+		float k = rms > 0 ? target / rms : 1.f;
+
+		sf::Vector2f board = layout.getBoardSize();
+		sf::Vector2f offset = layout.getBoardOffset();
+		for (int v = 0; v < n; ++v) {
+			sf::Vector2f p = board / 2.f + sf::Vector2f(x[v] - cx, y[v] - cy) * k;
+			// far outliers such as isolated nodes go to the border, not all to one point
+			float jx = rnd01() * 20, jy = rnd01() * 20;
+			p.x = std::min(std::max(p.x, offset.x + jx), board.x - offset.x - jx);
+			p.y = std::min(std::max(p.y, offset.y + jy), board.y - offset.y - jy);
+			layout.setPos(v, p);
+			layout.clearVelocity(v);
+		}
+		levels.clear();
+	}
+};
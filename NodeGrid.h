@@ -0,0 +1,121 @@
+#pragma once
+
+#include <SFML/Graphics/Rect.hpp>
+#include <vector>
+#include <unordered_map>
+#include <cmath>
+#include <algorithm>
+
+// Uniform grid over node centers for picking and area queries. Cells are kept in a
+// hash map, so nodes may be anywhere, and a node only changes cell lists when its
+// center crosses into another cell.
+class NodeGrid {
+private:
+	float cellSize = 64;
+	std::unordered_map <long long, std::vector <int>> cells;
+	std::vector <long long> nodeCell;
+	std::vector <int> slot; // position of the node in its cell list
+
+	static long long key(int cx, int cy) {
+		return (long long)cx << 32 | (unsigned int)cy;
+	}
+	int coord(float v) const {
+		return (int)std::floor(v / cellSize);
+	}
+
+	void insert(int i, long long k) {
+		std::vector <int>& list = cells[k];
+		nodeCell[i] = k;
+		slot[i] = list.size();
+		list.push_back(i);
+	}
+	void erase(int i) {
+		auto it = cells.find(nodeCell[i]);
+		std::vector <int>& list = it->second;
+		int last = list.back();
+		list[slot[i]] = last;
+		slot[last] = slot[i];
+		list.pop_back();
+		if (list.empty()) {
+			cells.erase(it);
+		}
+	}
+
+public:
+	// all nodes are removed
+	void setCellSize(float size) {
+		cellSize = size;
+		clear();
+	}
+	float getCellSize() const {
+		return cellSize;
+	}
+
+	void clear() {
+		cells.clear();
+		nodeCell.clear();
+		slot.clear();
+	}
+
+	int size() const {
+		return nodeCell.size();
+	}
+
+	// node i (new ones must come in order) is now at pos
+	void update(int i, const sf::Vector2f& pos) {
+		long long k = key(coord(pos.x), coord(pos.y));
+		if (i == nodeCell.size()) {
+			nodeCell.push_back(k);
+			slot.push_back(0);
+			insert(i, k);
+		}
+		else if (nodeCell[i] != k) {
+			erase(i);
+			insert(i, k);
+		}
+	}
+
+	// the last node takes index i
+	void remove(int i) {
+		int last = nodeCell.size() - 1;
+		erase(i);
+		if (i != last) {
+			cells[nodeCell[last]][slot[last]] = i;
+			nodeCell[i] = nodeCell[last];
+			slot[i] = slot[last];
+		}
+		nodeCell.pop_back();
+		slot.pop_back();
+	}
+
+	// f(i) for every node whose center may be in rect; cells are walked one by one
+	// when there are fewer of them in rect than occupied ones, otherwise all occupied cells are
+	template <class F>
+	void forEachInRect(const sf::FloatRect& rect, F f) const {
+		int x1 = coord(std::min(rect.left, rect.left + rect.width));
+		int x2 = coord(std::max(rect.left, rect.left + rect.width));
+		int y1 = coord(std::min(rect.top, rect.top + rect.height));
+		int y2 = coord(std::max(rect.top, rect.top + rect.height));
+		if ((double)(x2 - x1 + 1) * (y2 - y1 + 1) <= cells.size()) {
+			for (int cx = x1; cx <= x2; ++cx) {
+				for (int cy = y1; cy <= y2; ++cy) {
+					auto it = cells.find(key(cx, cy));
+					if (it != cells.end()) {
+						for (int i : it->second) {
+							f(i);
+						}
+					}
+				}
+			}
+			return;
+		}
+		for (const auto& [k, list] : cells) {
+			int cx = (int)(k >> 32), cy = (int)(unsigned int)k;
+			if (cx >= x1 && cx <= x2 && cy >= y1 && cy <= y2) {
+				for (int i : list) {
+					f(i);
+				}
+			}
+		}
+	}
+};
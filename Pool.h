@@ -0,0 +1,102 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cassert>
+
+// Objects of one type in one array, addressed by 32-bit handles that stay valid until
+// the object is released. Released slots go to a free list and are reused, so deleting
+// and adding elements does not allocate, and n of them take one reserve(n).
+// The low indexBits of a handle are the slot and the high bits are the generation of the
+// slot, which changes on every release, so a handle kept after its object was released
+// does not refer to the next object in that slot (until the generation wraps around).
+template <class T>
+class Pool {
+public:
+	typedef uint32_t Handle;
+	static const int indexBits = 24;
+	static const Handle indexMask = (Handle(1) << indexBits) - 1;
+
+private:
+	std::vector <T> slots;
+	std::vector <char> alive;
+	// generation of every slot ever used, kept by clear()
+	std::vector <Handle> generation;
+	std::vector <Handle> freeList;
+	int count = 0;
+
+	static Handle index(Handle h) {
+		return h & indexMask;
+	}
+
+	void bump(Handle i) {
+		generation[i] = (generation[i] + 1) & (Handle(-1) >> indexBits);
+	}
+
+public:
+	void reserve(int n) {
+		slots.reserve(n);
+		alive.reserve(n);
+		generation.reserve(n);
+	}
+
+	// a default constructed object
+	Handle create() {
+		Handle i;
+		if (!freeList.empty()) {
+			i = freeList.back();
+			freeList.pop_back();
+			alive[i] = true;
+		}
+		else {
+			i = slots.size();
+			assert(i <= indexMask);
+			slots.emplace_back();
+			alive.push_back(true);
+			if (i == generation.size())
+				generation.push_back(0);
+		}
+		++count;
+		return generation[i] << indexBits | i;
+	}
+
+	// the object is reset, so whatever it owned is freed now and not when the slot is reused
+	void release(Handle h) {
+		assert(isAlive(h));
+		Handle i = index(h);
+		slots[i] = T();
+		alive[i] = false;
+		bump(i);
+		freeList.push_back(i);
+		--count;
+	}
+
+	// slots are kept for the next objects, handles of the current ones become stale
+	void clear() {
+		for (Handle i = 0; i < alive.size(); ++i)
+			if (alive[i])
+				bump(i);
+		slots.clear();
+		alive.clear();
+		freeList.clear();
+		count = 0;
+	}
+
+	bool isAlive(Handle h) const {
+		Handle i = index(h);
+		return i < alive.size() && alive[i] && generation[i] == h >> indexBits;
+	}
+
+	T& operator[](Handle h) {
+		assert(isAlive(h));
+		return slots[index(h)];
+	}
+	const T& operator[](Handle h) const {
+		assert(isAlive(h));
+		return slots[index(h)];
+	}
+
+	int size() const {
+		return count;
+	}
+};
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <fstream>
+#include <cstring>
+
+// Scoped timers for finding where frame time goes. Every scope is kept as an event
+// for a Chrome trace (chrome://tracing or Perfetto), and its time is summed per frame,
+// so the last frames of every phase can be shown as percentiles. Phases that run on
+// several threads at once are summed over the threads.
+class Profiler {
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	struct Row {
+		std::string name;
+		int depth;
+		float p50, p95, p99; // ms per frame
+	};
+
+private:
+	struct Event {
+		int phase;
+		int tid;
+		long long start; // microseconds since the profiler was created
+		long long dur;
+	};
+	struct Phase {
+		const char* name;
+		int depth;
+		double frameSum = 0;
+		std::vector <float> history; // ring of the last historySize frames
+	};
+
+	static const int historySize = 240;
+	static const size_t maxEvents = 1 << 18;
+
+	std::mutex mtx;
+	std::atomic <bool> enabled{ false };
+	Clock::time_point origin = Clock::now();
+	std::deque <Event> events;
+	std::vector <Phase> phases;
+	std::vector <std::thread::id> threads;
+	int frames = 0;
+
+	long long micros(Clock::time_point t) const {
+		return std::chrono::duration_cast <std::chrono::microseconds>(t - origin).count();
+	}
+
+	int threadIndex() {
+		std::thread::id id = std::this_thread::get_id();
+		for (int i = 0; i < threads.size(); ++i) {
+			if (threads[i] == id) {
+				return i;
+			}
+		}
+		threads.push_back(id);
+		return threads.size() - 1;
+	}
+
+	static float percentile(std::vector <float>& v, float p) {
+		if (v.empty()) {
+			return 0;
+		}
+		size_t k = std::min((size_t)(p * v.size()), v.size() - 1);
+		std::nth_element(v.begin(), v.begin() + k, v.end());
+		return v[k];
+	}
+
+public:
+	void setEnabled(bool on) {
+		enabled = on;
+	}
+	bool isEnabled() const {
+		return enabled;
+	}
+
+	// id of the phase called name (a string literal), phases are listed in the order they first start;
+	// a worker thread starts nesting from 0, so a phase is shown as deep as it has ever been
+	int phase(const char* name, int depth) {
+		std::lock_guard <std::mutex> lock(mtx);
+		for (int i = 0; i < phases.size(); ++i) {
+			if (std::strcmp(phases[i].name, name) == 0) {
+				phases[i].depth = std::max(phases[i].depth, depth);
+				return i;
+			}
+		}
+		Phase ph;
+		ph.name = name;
+		ph.depth = depth;
+		phases.push_back(ph);
+		return phases.size() - 1;
+	}
+
+	void record(int id, Clock::time_point begin, Clock::time_point end) {
+		std::lock_guard <std::mutex> lock(mtx);
+		long long start = micros(begin);
+		events.push_back({ id, threadIndex(), start, micros(end) - start });
+		if (events.size() > maxEvents) {
+			events.pop_front();
+		}
+		phases[id].frameSum += std::chrono::duration <double, std::milli>(end - begin).count();
+	}
+
+	// the time of every phase in this frame goes to its history
+	void endFrame() {
+		std::lock_guard <std::mutex> lock(mtx);
+		for (auto& ph : phases) {
+			ph.history.resize(historySize);
+			ph.history[frames % historySize] = ph.frameSum;
+			ph.frameSum = 0;
+		}
+		++frames;
+	}
+
+	std::vector <Row> getRows() {
+		std::lock_guard <std::mutex> lock(mtx);
+		std::vector <Row> rows;
+		int filled = std::min(frames, historySize);
+		for (auto& ph : phases) {
+			std::vector <float> v(ph.history.begin(), ph.history.begin() + std::min((int)ph.history.size(), filled));
+			rows.push_back({ ph.name, ph.depth, percentile(v, 0.5f), percentile(v, 0.95f), percentile(v, 0.99f) });
+		}
+		return rows;
+	}
+
+	// the events kept so far as Chrome trace_event JSON
+	bool save(const std::string& path) {
+		std::lock_guard <std::mutex> lock(mtx);
+		std::ofstream fout(path);
+		if (!fout) {
+			return false;
+		}
+		fout << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+		for (int t = 0; t < threads.size(); ++t) {
+			fout << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << t
+				<< ",\"args\":{\"name\":\"" << (t == 0 ? "main" : "thread " + std::to_string(t)) << "\"}},\n";
+		}
+		for (size_t i = 0; i < events.size(); ++i) {
+			const Event& ev = events[i];
+			fout << "{\"name\":\"" << phases[ev.phase].name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << ev.tid
+				<< ",\"ts\":" << ev.start << ",\"dur\":" << ev.dur << '}' << (i + 1 < events.size() ? ",\n" : "\n");
+		}
+		fout << "]}\n";
+		return (bool)fout;
+	}
+};
+
+Profiler profiler;
+
+// times the enclosing block as the phase name, free when the profiler is off
+class ProfileScope {
+private:
+	int id = -1;
+	Profiler::Clock::time_point begin;
+
+	static int& depth() {
+		thread_local int d = 0;
+		return d;
+	}
+
+public:
+	ProfileScope(const char* name) {
+		if (profiler.isEnabled()) {
+			id = profiler.phase(name, depth()++);
+			begin = Profiler::Clock::now();
+		}
+	}
+	~ProfileScope() {
+		end();
+	}
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+	// ends the phase before the end of the block
+	void end() {
+		if (id != -1) {
+			profiler.record(id, begin, Profiler::Clock::now());
+			--depth();
+			id = -1;
+		}
+	}
+};
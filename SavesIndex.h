@@ -0,0 +1,309 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cmath>
+
+#include "MappedFile.h"
+#include "GraphSave.h"
+
+// Node and edge counts and a small thumbnail of every save in a directory, kept in an
+// index file there. A worker thread reads the index and then rescans the directory,
+// only files whose time or size changed since are opened again. The menu draws from
+// whatever is ready, getVersion() tells it when there is something new.
+//     "GDIX", version byte, u32 count, count entries:
+//     u32 name length, name, u64 time, u64 size, u32 nodes, u32 edges, u32 thumb size, thumb
+class SavesIndex {
+public:
+	static const int thumbSize = 48;
+
+	struct Entry {
+		std::string file; // name in the directory, with the extension
+		long long time = 0;
+		unsigned long long size = 0;
+		uint32_t nodes = 0;
+		uint32_t edges = 0;
+		std::vector <unsigned char> thumb; // thumbSize * thumbSize brightness, empty for saves without a layout
+	};
+
+private:
+	std::string dir;
+	std::string indexPath;
+
+	std::mutex mtx;
+	std::condition_variable cv;
+	std::vector <Entry> entries;
+	std::atomic <int> version{ 0 };
+	std::atomic <bool> scanned{ false };
+	std::atomic <bool> scanning{ true };
+	bool rescan = true;
+	bool stop = false;
+	std::thread worker;
+
+	static const char* magic() {
+		return "GDIX";
+	}
+
+	static void putU64(std::string& out, unsigned long long val) {
+		gsave::putU32(out, (uint32_t)val);
+		gsave::putU32(out, (uint32_t)(val >> 32));
+	}
+	static unsigned long long getU64(const char*& p) {
+		unsigned long long lo = gsave::getU32(p);
+		return lo | (unsigned long long)gsave::getU32(p) << 32;
+	}
+
+	void publish(const std::vector <Entry>& list) {
+		std::lock_guard <std::mutex> lock(mtx);
+		entries = list;
+		++version;
+	}
+
+	std::vector <Entry> readIndex() const {
+		std::vector <Entry> list;
+		MappedFile file;
+		if (!file.open(indexPath) || file.size() < 9 || std::string(file.data(), 4) != magic() || file.data()[4] != 1) {
+			return list;
+		}
+		const char* p = file.data() + 5;
+		const char* end = file.data() + file.size();
+		uint32_t count = gsave::getU32(p);
+		for (uint32_t i = 0; i < count; ++i) {
+			Entry e;
+			if (end - p < 4) {
+				break;
+			}
+			uint32_t len = gsave::getU32(p);
+			if (end - p < (long long)len + 28) {
+				break;
+			}
+			e.file.assign(p, len);
+			p += len;
+			e.time = getU64(p);
+			e.size = getU64(p);
+			e.nodes = gsave::getU32(p);
+			e.edges = gsave::getU32(p);
+			uint32_t thumbLen = gsave::getU32(p);
+			if (end - p < thumbLen) {
+				break;
+			}
+			e.thumb.assign(p, p + thumbLen);
+			p += thumbLen;
+			list.push_back(std::move(e));
+		}
+		return list;
+	}
+
+	void writeIndex(const std::vector <Entry>& list) const {
+		std::string buf(magic(), 4);
+		buf += (char)1;
+		gsave::putU32(buf, list.size());
+		for (const auto& e : list) {
+			gsave::putU32(buf, e.file.size());
+			buf += e.file;
+			putU64(buf, e.time);
+			putU64(buf, e.size);
+			gsave::putU32(buf, e.nodes);
+			gsave::putU32(buf, e.edges);
+			gsave::putU32(buf, e.thumb.size());
+			buf.append(e.thumb.begin(), e.thumb.end());
+		}
+		std::ofstream fout(indexPath, std::ios::binary);
+		fout.write(buf.data(), buf.size());
+	}
+
+	// brightness is 1 - e^(-coverage / mean coverage), so sparse and dense graphs both show
+	static std::vector <unsigned char> makeThumb(const std::vector <float>& x, const std::vector <float>& y,
+		const std::vector <std::pair <uint32_t, uint32_t>>& edges) {
+		std::vector <unsigned char> res;
+		if (x.empty()) {
+			return res;
+		}
+		float minX = *std::min_element(x.begin(), x.end()), maxX = *std::max_element(x.begin(), x.end());
+		float minY = *std::min_element(y.begin(), y.end()), maxY = *std::max_element(y.begin(), y.end());
+		float k = (thumbSize - 3) / std::max(std::max(maxX - minX, maxY - minY), 1e-6f);
+		float offX = (thumbSize - (maxX - minX) * k) / 2, offY = (thumbSize - (maxY - minY) * k) / 2;
+		auto px = [&](int i) { return (x[i] - minX) * k + offX; };
+		auto py = [&](int i) { return (y[i] - minY) * k + offY; };
+
+		std::vector <float> acc(thumbSize * thumbSize, 0.f);
+		auto plot = [&](float fx, float fy, float w) {
+			int ix = (int)fx, iy = (int)fy;
+			if (ix >= 0 && iy >= 0 && ix < thumbSize && iy < thumbSize) {
+				acc[iy * thumbSize + ix] += w;
+			}
+		};
+		for (auto [u, v] : edges) {
+			float dx = px(v) - px(u), dy = py(v) - py(u);
+			int steps = (int)std::max(std::abs(dx), std::abs(dy)) + 1;
+			for (int s = 0; s <= steps; ++s) {
+				plot(px(u) + dx * s / steps, py(u) + dy * s / steps, 0.5f);
+			}
+		}
+		for (int i = 0; i < x.size(); ++i) {
+			plot(px(i), py(i), 1.f);
+		}
+
+		double sum = 0;
+		int used = 0;
+		for (float a : acc) {
+			sum += a;
+			used += a > 0;
+		}
+		float mean = used > 0 ? sum / used : 1.f;
+		res.resize(acc.size());
+		for (int i = 0; i < acc.size(); ++i) {
+			res[i] = (unsigned char)(255 * (1 - std::exp(-acc[i] / mean)));
+		}
+		return res;
+	}
+
+	static void readSave(const std::string& path, Entry& e) {
+		e.nodes = e.edges = 0;
+		e.thumb.clear();
+		if (std::filesystem::path(path).extension() == ".txt") {
+			std::ifstream fin(path);
+			fin >> e.nodes >> e.edges;
+			return;
+		}
+		MappedFile file;
+		if (!file.open(path) || !gsave::isSave(file.data(), file.size())) {
+			return;
+		}
+		const char* p = file.data() + 5;
+		uint32_t n = gsave::getU32(p);
+		uint32_t m = gsave::getU32(p);
+		gsave::getU32(p);
+		if (file.size() < gsave::headerSize + (uint64_t)n * gsave::nodeSize + (uint64_t)m * gsave::edgeSize) {
+			return;
+		}
+		e.nodes = n;
+		e.edges = m;
+		std::vector <float> x(n), y(n);
+		for (uint32_t i = 0; i < n; ++i) {
+			x[i] = gsave::getFloat(p);
+			y[i] = gsave::getFloat(p);
+			p += 8;
+		}
+		std::vector <std::pair <uint32_t, uint32_t>> edges;
+		edges.reserve(m);
+		for (uint32_t i = 0; i < m; ++i) {
+			uint32_t u = gsave::getU32(p);
+			uint32_t v = gsave::getU32(p);
+			p += 4;
+			if (u < n && v < n) {
+				edges.push_back({ u, v });
+			}
+		}
+		e.thumb = makeThumb(x, y, edges);
+	}
+
+	void scan(std::vector <Entry>& list) {
+		std::map <std::string, Entry> known;
+		for (auto& e : list) {
+			known[e.file] = std::move(e);
+		}
+		std::vector <Entry> res;
+		bool changed = false;
+		std::error_code ec;
+		for (std::filesystem::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+			std::string ext = it->path().extension().string();
+			if (ext != ".txt" && ext != ".graph") {
+				continue;
+			}
+			Entry e;
+			e.file = it->path().filename().string();
+			e.time = it->last_write_time(ec).time_since_epoch().count();
+			e.size = it->file_size(ec);
+			auto old = known.find(e.file);
+			if (old != known.end() && old->second.time == e.time && old->second.size == e.size) {
+				res.push_back(std::move(old->second));
+				known.erase(old);
+				continue;
+			}
+			readSave(it->path().string(), e);
+			res.push_back(std::move(e));
+			changed = true;
+		}
+		changed |= !known.empty();
+		std::sort(res.begin(), res.end(), [](const Entry& a, const Entry& b) {
+			return a.file < b.file;
+		});
+		list.swap(res);
+		if (changed) {
+			writeIndex(list);
+		}
+	}
+
+	void loop() {
+		std::vector <Entry> list = readIndex();
+		publish(list);
+		while (true) {
+			{
+				std::unique_lock <std::mutex> lock(mtx);
+				cv.wait(lock, [&] { return stop || rescan; });
+				if (stop) {
+					return;
+				}
+				rescan = false;
+			}
+			scan(list);
+			scanned = true;
+			publish(list);
+			std::lock_guard <std::mutex> lock(mtx);
+			scanning = rescan;
+		}
+	}
+
+public:
+	// dir ends with a separator
+	SavesIndex(const std::string& _dir) : dir(_dir), indexPath(_dir + "index.bin") {
+		worker = std::thread(&SavesIndex::loop, this);
+	}
+	~SavesIndex() {
+		{
+			std::lock_guard <std::mutex> lock(mtx);
+			stop = true;
+		}
+		cv.notify_all();
+		worker.join();
+	}
+
+	SavesIndex(const SavesIndex&) = delete;
+	SavesIndex& operator=(const SavesIndex&) = delete;
+
+	// the directory is scanned again in the background
+	void refresh() {
+		{
+			std::lock_guard <std::mutex> lock(mtx);
+			rescan = true;
+			scanning = true;
+		}
+		cv.notify_all();
+	}
+
+	// grows every time new entries are ready
+	int getVersion() const {
+		return version;
+	}
+	// the directory has been scanned at least once, before that entries come from the index file
+	bool isScanned() const {
+		return scanned;
+	}
+	// a scan is running or asked for
+	bool isScanning() const {
+		return scanning;
+	}
+	std::vector <Entry> getEntries() {
+		std::lock_guard <std::mutex> lock(mtx);
+		return entries;
+	}
+};
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <cmath>
+#include <algorithm>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define SIMD_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SIMD_SSE
+#endif
+
+// Packs of floats for the physics kernels. A kernel is written once as a template
+// over the pack type and runs on FloatPack for the body of a loop and on Float1 for the tail.
+
+struct Float1 {
+	static const int width = 1;
+	float v;
+
+	Float1() : v(0) {}
+	Float1(float _v) : v(_v) {}
+
+	static Float1 load(const float* p) {
+		return *p;
+	}
+	void store(float* p) const {
+		*p = v;
+	}
+
+	// val where cond > 0, else 0
+	static Float1 ifPositive(const Float1& cond, const Float1& val) {
+		return cond.v > 0 ? val.v : 0.f;
+	}
+
+	float sum() const {
+		return v;
+	}
+	float max() const {
+		return v;
+	}
+
+	friend Float1 operator+(const Float1& a, const Float1& b) {
+		return a.v + b.v;
+	}
+	friend Float1 operator-(const Float1& a, const Float1& b) {
+		return a.v - b.v;
+	}
+	friend Float1 operator*(const Float1& a, const Float1& b) {
+		return a.v * b.v;
+	}
+	friend Float1 operator/(const Float1& a, const Float1& b) {
+		return a.v / b.v;
+	}
+	friend Float1 sqrt(const Float1& a) {
+		return std::sqrt(a.v);
+	}
+	friend Float1 max(const Float1& a, const Float1& b) {
+		return std::max(a.v, b.v);
+	}
+};
+
+#ifdef SIMD_AVX
+struct Float8 {
+	static const int width = 8;
+	__m256 v;
+
+	Float8() : v(_mm256_setzero_ps()) {}
+	Float8(__m256 _v) : v(_v) {}
+	Float8(float _v) : v(_mm256_set1_ps(_v)) {}
+
+	static Float8 load(const float* p) {
+		return _mm256_loadu_ps(p);
+	}
+	void store(float* p) const {
+		_mm256_storeu_ps(p, v);
+	}
+
+	static Float8 ifPositive(const Float8& cond, const Float8& val) {
+		return _mm256_and_ps(_mm256_cmp_ps(cond.v, _mm256_setzero_ps(), _CMP_GT_OQ), val.v);
+	}
+
+	float sum() const {
+		__m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+		s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+		s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+		return _mm_cvtss_f32(s);
+	}
+	float max() const {
+		__m128 s = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+		s = _mm_max_ps(s, _mm_movehl_ps(s, s));
+		s = _mm_max_ss(s, _mm_shuffle_ps(s, s, 1));
+		return _mm_cvtss_f32(s);
+	}
+
+	friend Float8 operator+(const Float8& a, const Float8& b) {
+		return _mm256_add_ps(a.v, b.v);
+	}
+	friend Float8 operator-(const Float8& a, const Float8& b) {
+		return _mm256_sub_ps(a.v, b.v);
+	}
+	friend Float8 operator*(const Float8& a, const Float8& b) {
+		return _mm256_mul_ps(a.v, b.v);
+	}
+	friend Float8 operator/(const Float8& a, const Float8& b) {
+		return _mm256_div_ps(a.v, b.v);
+	}
+	friend Float8 sqrt(const Float8& a) {
+		return _mm256_sqrt_ps(a.v);
+	}
+	friend Float8 max(const Float8& a, const Float8& b) {
+		return _mm256_max_ps(a.v, b.v);
+	}
+};
+
+typedef Float8 FloatPack;
+#elif defined(SIMD_SSE)
+struct Float4 {
+	static const int width = 4;
+	__m128 v;
+
+	Float4() : v(_mm_setzero_ps()) {}
+	Float4(__m128 _v) : v(_v) {}
+	Float4(float _v) : v(_mm_set1_ps(_v)) {}
+
+	static Float4 load(const float* p) {
+		return _mm_loadu_ps(p);
+	}
+	void store(float* p) const {
+		_mm_storeu_ps(p, v);
+	}
+
+	static Float4 ifPositive(const Float4& cond, const Float4& val) {
+		return _mm_and_ps(_mm_cmpgt_ps(cond.v, _mm_setzero_ps()), val.v);
+	}
+
+	float sum() const {
+		__m128 s = _mm_add_ps(v, _mm_movehl_ps(v, v));
+		s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+		return _mm_cvtss_f32(s);
+	}
+	float max() const {
+		__m128 s = _mm_max_ps(v, _mm_movehl_ps(v, v));
+		s = _mm_max_ss(s, _mm_shuffle_ps(s, s, 1));
+		return _mm_cvtss_f32(s);
+	}
+
+	friend Float4 operator+(const Float4& a, const Float4& b) {
+		return _mm_add_ps(a.v, b.v);
+	}
+	friend Float4 operator-(const Float4& a, const Float4& b) {
+		return _mm_sub_ps(a.v, b.v);
+	}
+	friend Float4 operator*(const Float4& a, const Float4& b) {
+		return _mm_mul_ps(a.v, b.v);
+	}
+	friend Float4 operator/(const Float4& a, const Float4& b) {
+		return _mm_div_ps(a.v, b.v);
+	}
+	friend Float4 sqrt(const Float4& a) {
+		return _mm_sqrt_ps(a.v);
+	}
+	friend Float4 max(const Float4& a, const Float4& b) {
+		return _mm_max_ps(a.v, b.v);
+	}
+};
+
+typedef Float4 FloatPack;
+#else
+typedef Float1 FloatPack;
+#endif
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+#include "Layout.h"
+#include "TripleBuffer.h"
+#include "Profiler.h"
+
+// Physics of a layout on a thread of its own until the layout falls asleep, as fast as its
+// threads allow or at most setStepRate steps a second. The layout there is a copy kept in
+// step with the one the caller edits: the caller journals its edits (Layout::setJournal) and hands them over with submit,
+// they are replayed before the next step. Positions after every step come back through
+// a triple buffer, so the caller never waits for a step and a step never waits for a frame.
+class Simulation {
+public:
+	struct Frame {
+		std::vector <float> x;
+		std::vector <float> y;
+		long long ops = 0;     // edits replayed before this frame
+		long long nodeOps = 0; // those of them that change node indices
+		bool sleeping = false;
+	};
+
+private:
+	Layout layout;
+	TripleBuffer <Frame> frames;
+
+	std::mutex mtx;
+	std::condition_variable cv;
+	std::vector <Layout::Op> queue;
+	bool stop = false;
+	std::chrono::steady_clock::duration stepInterval;
+	std::thread worker;
+
+	// simulation thread
+	long long ops = 0;
+	long long nodeOps = 0;
+
+	// caller thread
+	long long sentOps = 0;
+	long long sentNodeOps = 0;
+	long long seenOps = 0;
+	bool seenSleeping = true;
+	std::deque <Layout::Op> pending; // submitted after the last frame taken
+
+	void loop() {
+		using clock = std::chrono::steady_clock;
+		std::vector <Layout::Op> batch;
+		clock::time_point next = clock::now();
+		clock::duration interval;
+		while (true) {
+			{
+				// edits are taken at once, the next step waits for its time
+				std::unique_lock <std::mutex> lock(mtx);
+				auto ready = [&] { return stop || !queue.empty(); };
+				if (layout.isSleeping()) {
+					cv.wait(lock, ready);
+				}
+				else {
+					cv.wait_until(lock, next, ready);
+				}
+				if (stop) {
+					return;
+				}
+				batch.swap(queue);
+				interval = stepInterval;
+			}
+			bool wasSleeping = layout.isSleeping();
+			for (const auto& op : batch) {
+				layout.apply(op);
+				nodeOps += op.isNodeOp();
+			}
+			ops += batch.size();
+			bool edited = !batch.empty();
+			batch.clear();
+
+			clock::time_point now = clock::now();
+			if (wasSleeping) {
+				next = now;
+			}
+			bool stepped = false;
+			if (!layout.isSleeping() && now >= next) {
+				ProfileScope scope("simulation");
+				layout.step();
+				stepped = true;
+				// a late step is not made up for, like the substeps dropped by Layout::advance
+				next = std::max(next + interval, now);
+			}
+			if (!edited && !stepped) {
+				continue;
+			}
+
+			Frame& frame = frames.back();
+			layout.getPositions(frame.x, frame.y);
+			frame.ops = ops;
+			frame.nodeOps = nodeOps;
+			frame.sleeping = layout.isSleeping();
+			frames.publish();
+		}
+	}
+
+public:
+	Simulation() {
+		setStepRate(0);
+		worker = std::thread(&Simulation::loop, this);
+	}
+	~Simulation() {
+		{
+			std::lock_guard <std::mutex> lock(mtx);
+			stop = true;
+		}
+		cv.notify_all();
+		worker.join();
+	}
+
+	Simulation(const Simulation&) = delete;
+	Simulation& operator=(const Simulation&) = delete;
+
+	// edits in the order they were made, ops is left empty
+	void submit(std::vector <Layout::Op>& ops) {
+		if (ops.empty()) {
+			return;
+		}
+		for (const auto& op : ops) {
+			sentNodeOps += op.isNodeOp();
+		}
+		sentOps += ops.size();
+		pending.insert(pending.end(), ops.begin(), ops.end());
+		{
+			std::lock_guard <std::mutex> lock(mtx);
+			if (queue.empty()) {
+				queue.swap(ops);
+			}
+			else {
+				queue.insert(queue.end(), ops.begin(), ops.end());
+			}
+		}
+		ops.clear();
+		cv.notify_one();
+	}
+
+	void setThreads(int threads) {
+		std::vector <Layout::Op> ops = { { Layout::Op::SetThreads, threads } };
+		submit(ops);
+	}
+
+	// steps a second, 0 - as fast as the threads allow; 1 / Layout::fixedStep is real time
+	void setStepRate(float rate) {
+		{
+			std::lock_guard <std::mutex> lock(mtx);
+			stepInterval = rate > 0 ? std::chrono::duration_cast <std::chrono::steady_clock::duration>(
+				std::chrono::duration <float>(1 / rate)) : std::chrono::steady_clock::duration::zero();
+		}
+		cv.notify_one();
+	}
+
+	// the newest frame if it came after the last call and has the nodes that were
+	// submitted so far, so its positions belong to the same indices; nullptr otherwise.
+	// Edits the frame is still missing are in getPending().
+	const Frame* takeFrame() {
+		if (!frames.update()) {
+			return nullptr;
+		}
+		const Frame& frame = frames.front();
+		pending.erase(pending.begin(), pending.begin() + (frame.ops - seenOps));
+		seenOps = frame.ops;
+		seenSleeping = frame.sleeping;
+		return frame.nodeOps == sentNodeOps ? &frame : nullptr;
+	}
+
+	// edits submitted after the frame taken last, in order
+	const std::deque <Layout::Op>& getPending() const {
+		return pending;
+	}
+
+	// the layout is asleep and has seen every edit
+	bool isSleeping() const {
+		return seenSleeping && seenOps == sentOps;
+	}
+};
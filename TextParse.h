@@ -0,0 +1,193 @@
+#pragma once
+
+#include <vector>
+#include <string_view>
+#include <charconv>
+#include <cstring>
+#include <thread>
+#include <algorithm>
+
+#include "GraphTrace.h"
+
+// The text format read straight out of a buffer (a mapped file) with std::from_chars,
+// without the locale and stream state work of iostream extraction. Every function moves p
+// past what it has read and fails, like the stream, on anything that is not a number.
+namespace tparse {
+	inline bool isSpace(char c) {
+		return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+	}
+
+	inline void skipSpace(const char*& p, const char* end) {
+		while (p < end && isSpace(*p)) {
+			++p;
+		}
+	}
+
+	template <class T>
+	inline bool getInt(const char*& p, const char* end, T& val) {
+		skipSpace(p, end);
+		auto res = std::from_chars(p, end, val);
+		if (res.ec != std::errc()) {
+			return false;
+		}
+		p = res.ptr;
+		return true;
+	}
+
+	inline std::string_view getWord(const char*& p, const char* end) {
+		skipSpace(p, end);
+		const char* start = p;
+		while (p < end && !isSpace(*p)) {
+			++p;
+		}
+		return std::string_view(start, p - start);
+	}
+
+	inline void skipLine(const char*& p, const char* end) {
+		const char* nl = (const char*)std::memchr(p, '\n', end - p);
+		p = nl != nullptr ? nl + 1 : end;
+	}
+
+	// as gtrace::readText: "nc v col", "ec e col", "ea u v" or "ed e" with 1-based ids,
+	// an unknown line is skipped
+	inline bool getRecord(const char*& p, const char* end, gtrace::Record& rec) {
+		std::string_view type = getWord(p, end);
+		rec = gtrace::Record();
+		bool ok;
+		if (type == "nc") {
+			rec.op = gtrace::NodeColor;
+			ok = getInt(p, end, rec.a) && getInt(p, end, rec.b);
+		}
+		else if (type == "ec") {
+			rec.op = gtrace::EdgeColor;
+			ok = getInt(p, end, rec.a) && getInt(p, end, rec.b);
+		}
+		else if (type == "ea") {
+			rec.op = gtrace::EdgeAdd;
+			ok = getInt(p, end, rec.a) && getInt(p, end, rec.b);
+			--rec.b;
+		}
+		else if (type == "ed") {
+			rec.op = gtrace::EdgeDelete;
+			ok = getInt(p, end, rec.a);
+		}
+		else {
+			skipLine(p, end);
+			return false;
+		}
+		--rec.a;
+		return ok;
+	}
+
+	// m edges "u v" with 1-based ids, made 0-based, one by one
+	inline bool getEdgesSerial(const char*& p, const char* end, int m, std::vector <std::pair <int, int>>& edges) {
+		if (m < 0) {
+			return false;
+		}
+		edges.resize(m);
+		for (auto& [u, v] : edges) {
+			if (!getInt(p, end, u) || !getInt(p, end, v)) {
+				return false;
+			}
+			--u;
+			--v;
+		}
+		return true;
+	}
+
+	// fn(0) on the calling thread and fn(1) .. fn(threads - 1) on threads of their own
+	template <class Fn>
+	inline void runThreads(int threads, Fn fn) {
+		std::vector <std::thread> worker;
+		for (int t = 1; t < threads; ++t) {
+			worker.emplace_back(fn, t);
+		}
+		fn(0);
+		for (auto& th : worker) {
+			th.join();
+		}
+	}
+
+	// m edges "u v" with 1-based ids, made 0-based. The m lines they take (as gdraw and
+	// saves write them) are found by counting line breaks and cut into byte ranges at
+	// line starts; both the counting and the parsing of the ranges run on threads threads
+	// and the results are stitched in order. If the lines turn out not to hold exactly
+	// two numbers each, the edges are read again one by one.
+	inline bool getEdges(const char*& p, const char* end, int m, std::vector <std::pair <int, int>>& edges, int threads) {
+		const size_t minChunk = 1 << 20;
+		if (m < 0) {
+			return false;
+		}
+		skipSpace(p, end);
+		threads = std::max(1, std::min(threads, (int)((end - p) / minChunk) + 1));
+		if (threads == 1) {
+			return getEdgesSerial(p, end, m, edges);
+		}
+
+		// the end of the m-th line
+		size_t bytes = end - p;
+		std::vector <size_t> lines(threads);
+		runThreads(threads, [&](int t) {
+			lines[t] = std::count(p + bytes * t / threads, p + bytes * (t + 1) / threads, '\n');
+		});
+		const char* sectionEnd = end;
+		size_t before = 0;
+		for (int t = 0; t < threads; ++t) {
+			if (before + lines[t] >= m) {
+				sectionEnd = p + bytes * t / threads;
+				for (size_t i = before; i < m; ++i) {
+					skipLine(sectionEnd, end);
+				}
+				break;
+			}
+			before += lines[t];
+		}
+
+		bytes = sectionEnd - p;
+		std::vector <const char*> cut(threads + 1);
+		cut[0] = p;
+		cut[threads] = sectionEnd;
+		for (int t = 1; t < threads; ++t) {
+			const char* q = p + bytes * t / threads;
+			if (q > cut[t - 1]) {
+				skipLine(q, sectionEnd);
+			}
+			cut[t] = std::max(q, cut[t - 1]);
+		}
+
+		std::vector <std::vector <std::pair <int, int>>> part(threads);
+		std::vector <char> ok(threads, true);
+		runThreads(threads, [&](int t) {
+			const char* q = cut[t];
+			auto& res = part[t];
+			res.reserve((size_t)m / threads + 16);
+			while (true) {
+				skipSpace(q, cut[t + 1]);
+				if (q == cut[t + 1]) {
+					break;
+				}
+				int u, v;
+				if (!getInt(q, cut[t + 1], u) || !getInt(q, cut[t + 1], v)) {
+					ok[t] = false;
+					return;
+				}
+				res.push_back({ u - 1, v - 1 });
+			}
+		});
+
+		size_t total = 0;
+		for (int t = 0; t < threads; ++t) {
+			total += part[t].size();
+		}
+		if (std::count(ok.begin(), ok.end(), false) > 0 || total != m) {
+			return getEdgesSerial(p, end, m, edges);
+		}
+		edges.resize(m);
+		auto out = edges.begin();
+		for (const auto& res : part) {
+			out = std::copy(res.begin(), res.end(), out);
+		}
+		p = sectionEnd;
+		return true;
+	}
+}
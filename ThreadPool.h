@@ -0,0 +1,107 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+
+// Persistent workers that run one job on every thread at once.
+// run(fn) calls fn(0) on the calling thread and fn(1) .. fn(size() - 1) on the workers,
+// and returns when all of them are done, so job t always gets the same share of the work.
+class ThreadPool {
+private:
+	std::vector <std::thread> worker;
+	std::mutex mtx;
+	std::condition_variable startCv;
+	std::condition_variable doneCv;
+	const std::function <void(int)>* job = nullptr;
+	int generation = 0;
+	int pending = 0;
+	bool stop = false;
+
+	void loop(int t) {
+		int seen = 0;
+		while (true) {
+			const std::function <void(int)>* fn;
+			{
+				std::unique_lock <std::mutex> lock(mtx);
+				startCv.wait(lock, [&] { return stop || generation != seen; });
+				if (stop) {
+					return;
+				}
+				seen = generation;
+				fn = job;
+			}
+			(*fn)(t);
+			{
+				std::lock_guard <std::mutex> lock(mtx);
+				if (--pending == 0) {
+					doneCv.notify_one();
+				}
+			}
+		}
+	}
+
+	void join() {
+		{
+			std::lock_guard <std::mutex> lock(mtx);
+			stop = true;
+		}
+		startCv.notify_all();
+		for (auto& th : worker) {
+			th.join();
+		}
+		worker.clear();
+		stop = false;
+		generation = 0;
+	}
+
+public:
+	ThreadPool(int threads = 1) {
+		resize(threads);
+	}
+	~ThreadPool() {
+		join();
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	void resize(int threads) {
+		join();
+		for (int t = 1; t < threads; ++t) {
+			worker.emplace_back(&ThreadPool::loop, this, t);
+		}
+	}
+
+	int size() const {
+		return worker.size() + 1;
+	}
+
+	void run(const std::function <void(int)>& fn) {
+		if (worker.empty()) {
+			fn(0);
+			return;
+		}
+		{
+			std::lock_guard <std::mutex> lock(mtx);
+			job = &fn;
+			pending = worker.size();
+			++generation;
+		}
+		startCv.notify_all();
+		fn(0);
+		std::unique_lock <std::mutex> lock(mtx);
+		doneCv.wait(lock, [&] { return pending == 0; });
+	}
+
+	// [first, second) part t of [0, n) split into size() parts, borders are multiples of align
+	std::pair <int, int> range(int n, int t, int align = 1) const {
+		int blocks = (n + align - 1) / align;
+		int from = (long long)blocks * t / size() * align;
+		int to = (long long)blocks * (t + 1) / size() * align;
+		return { std::min(from, n), std::min(to, n) };
+	}
+};
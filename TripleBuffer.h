@@ -0,0 +1,38 @@
+#pragma once
+
+#include <atomic>
+
+// The latest value from one writer thread to one reader thread, neither of them ever
+// waits. The writer fills back() and publishes it; the reader takes the newest published
+// value with update() and reads front() until its next update. Three buffers, so
+// the writer always has one that the reader is not looking at.
+template <class T>
+class TripleBuffer {
+private:
+	static const int fresh = 4; // the middle buffer was published and not taken yet
+
+	T buf[3];
+	std::atomic <int> middle{ 1 };
+	int backInd = 0;
+	int frontInd = 2;
+
+public:
+	T& back() {
+		return buf[backInd];
+	}
+	void publish() {
+		backInd = middle.exchange(backInd | fresh, std::memory_order_acq_rel) & ~fresh;
+	}
+
+	// true if something was published since the last update
+	bool update() {
+		if ((middle.load(std::memory_order_acquire) & fresh) == 0) {
+			return false;
+		}
+		frontInd = middle.exchange(frontInd, std::memory_order_acq_rel) & ~fresh;
+		return true;
+	}
+	const T& front() const {
+		return buf[frontInd];
+	}
+};